@@ -2,18 +2,102 @@
 // Language: C++17
 // -------------------------------------------------------------
 // Brief report (design & notes):
-// - Implements FCFS, SJF (non-preemptive), Priority (non-preemptive), and Round Robin (preemptive).
+// - Implements FCFS, SJF (non-preemptive), Priority (non-preemptive), Round Robin (preemptive),
+//   SRTF (preemptive SJF), Priority (preemptive), a Multilevel Feedback Queue,
+//   and lottery and stride (proportional-share) scheduling.
 // - Menu-driven CLI with robust input validation and error handling.
 // - Generates an ASCII Gantt chart (with IDLE periods) and prints per-process
-//   metrics (Waiting/Turnaround/Completion) and averages.
+//   metrics (Waiting/Turnaround/Completion) and averages. Timelines too long
+//   to draw segment by segment are downsampled into fixed-width columns
+//   (dominant PID + busy shade), and batch mode can export them as SVG/HTML.
+// - Batch mode can write a run as a flat columnar binary file (writeResult);
+//   the per-process table is skipped for runs over kMaxTableRows processes.
+// - Batch --compact keeps a run's timeline as a CompactTimeline: varint
+//   records with implicit starts and back-copies for RR rotations, read
+//   through an iterator by the chart, metrics and exporters.
+// - Batch --pipeline reads, validates and simulates a sorted trace on three
+//   threads joined by lock-free SPSC rings of recycled batches, feeding the
+//   OnlineScheduler as records arrive.
 // - Comparison module runs all algorithms on the same process set (RR asks
-//   for Quantum) and selects the one with the smallest average waiting time.
+//   for Quantum) and selects the best one by average waiting time or any
+//   other statistic (percentiles, max, stddev, fairness). The algorithms
+//   run concurrently on a shared worker pool.
+// - Each run also reports p50/p90/p99/p99.9, max and stddev of waiting,
+//   turnaround and first-response time plus Jain's fairness, from mergeable
+//   log-linear histograms filled in one pass over the processes.
+// - Per-process turnaround/waiting and the averages are computed over the
+//   SoA columns by AVX2 (runtime-detected) or NEON kernels with a scalar
+//   fallback; sums are exact integers, so every path prints the same numbers.
 // - Data structures: Process to hold inputs; Segment to record timeline; Result
 //   to capture schedule, metrics, and averages. Queues/vectors used as needed.
 // - Assumptions: lower priority value means higher priority. SJF & Priority are
-//   non-preemptive; Round Robin is preemptive. Arrival times are supported.
-// - Compile:  g++ -std=gnu++17 -O2 -pipe -static -s -o scheduler cpu_scheduler.cpp
-// - Run:      ./scheduler
+//   non-preemptive; Round Robin, SRTF and Priority (Preemptive) are preemptive.
+//   Arrival times are supported.
+// - A process set is laid out once as SoA columns with one arrival order
+//   (LSD radix sort for large sets) that every run of that set reads.
+// - SJF & Priority share an arrival-cursor + binary-heap ready queue, so they
+//   run in O(n log n) instead of rescanning every process per dispatch. SRTF
+//   and preemptive Priority use the same heap and only reconsider the running
+//   process at arrival events.
+// - An SMP engine simulates M CPUs with per-CPU run queues (optionally with
+//   work stealing) and reports per-CPU utilization and load imbalance.
+// - RR keeps its ready queue in a PID ring buffer (O(1) per slice) and can
+//   optionally coalesce the slices of a lone runnable process into one Segment.
+// - MLFQ keeps one PID ring per level and a bitmask of non-empty levels, so
+//   picking the next level is a single find-first-set; it demotes on quantum
+//   expiry and periodically boosts everything back to the top level.
+// - Lottery and stride scheduling share the CPU in proportion to tickets
+//   derived from priority: lottery draws each slice's winner from a Fenwick
+//   tree over ticket counts in O(log n), stride runs the lowest pass value
+//   from the ready heap.
+// - Menu option 13 edits a single process. FCFS, SJF, Priority and RR runs
+//   from the menu keep checkpoints of their scheduler state, so a rerun after
+//   an edit replays only from the last checkpoint before the edited arrival.
+// - Menu option 18 inspects the last run piece by piece (a page of the
+//   per-process table, the Gantt chart of a time window, one PID's
+//   segments), so looking at a million-process run costs what is shown;
+//   batch --inspect opens the same inspector on a run over a trace.
+// - OnlineScheduler runs the same policies over a live arrival feed
+//   (submit / advanceTo / drainSegments) in memory bounded by the active
+//   processes; batch --stream drives it from a CSV pipe.
+// - Built with -DSCHED_INSTRUMENT, each run counts dispatches, context
+//   switches, idle gaps, ready-queue traffic and depth, and times the sort,
+//   simulate, metrics and print phases (batch --counters table|json); the
+//   default build compiles every probe away.
+// - Times are SimTime: int32 by default, int64 with -DSCHED_TIME64 for
+//   nanosecond-scale traces, with totals accumulated exactly in TimeSum.
+//   A set whose latest arrival plus bursts (plus worst-case switch charges)
+//   would pass SimTime is rejected where it is built (TimeBudget).
+//   Process-set and result files record their time width.
+// - Runs can charge a context-switch cost and a cache-warmup penalty (menu
+//   option 15, batch --switch-cost/--warmup). The overhead appears as CS
+//   segments and counts against waiting and turnaround; the cost model is an
+//   engine template parameter, so free dispatch runs the unchanged loops.
+// - SimulationContext keeps the engines' scratch buffers and one Result
+//   between runs, so repeated runs allocate nothing once warmed up.
+// - Monte Carlo evaluation (menu option 14, batch --monte-carlo K) runs every
+//   algorithm over K random workloads shaped like the current set and reports
+//   means with 95% confidence intervals, so a ranking is not an accident of
+//   one process set.
+// - A quantum sweep evaluates a range of RR quanta in parallel over one shared
+//   arrival order and prints the waiting/turnaround curve.
+// - A comparison grid (traces x algorithms x quanta x CPU counts) can be
+//   spread over worker processes on other hosts (--worker PORT on each,
+//   with --bind and --trace-root to leave loopback, --workers on the
+//   coordinator); workers send back mergeable summaries,
+//   failed units are retried elsewhere, and the merged table prints as one.
+// - Batch --verify K keeps the original FCFS/SJF/Priority/RR loops as a
+//   reference and checks every optimized path (sinks, SimulationContext,
+//   IncrementalRun, OnlineScheduler, one-CPU SMP) against them on K random
+//   sets, printing each path's speedup and a shrunk trace on a mismatch.
+// - Compile:  g++ -std=gnu++17 -O2 -pipe -pthread -static -s -o scheduler cpu_scheduler.cpp
+// - Run:      ./scheduler                      (interactive menu)
+//             ./scheduler --input trace.csv --algo rr --quantum 4
+//             (batch mode; see printUsage for all options and the trace
+//             and process-set formats described above loadTrace and
+//             writeProcessSet)
+// - Bench:    g++ -std=gnu++17 -O2 -pthread -o scheduler_bench scheduler_bench.cpp -lbenchmark
+//             (Google Benchmark suite over synthetic workloads; see that file)
 // -------------------------------------------------------------
 
 #include <iostream>
@@ -25,37 +109,666 @@
 #include <string>
 #include <sstream>
 #include <cmath>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <functional>
+#include <atomic>
+#include <random>
+#include <numeric>
+#include <deque>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <poll.h>
+// Metric kernels (see "Metric kernels"); -DSCHED_NO_SIMD keeps only the scalar
+// loop, as does the 64-bit time domain
+#if !defined(SCHED_NO_SIMD) && !defined(SCHED_TIME64) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SCHED_SIMD_NEON 1
+#elif !defined(SCHED_NO_SIMD) && !defined(SCHED_TIME64) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define SCHED_SIMD_AVX2 1
+#endif
 
 using namespace std;
 
+// Time domain, fixed at compile time: 32-bit by default, which keeps the
+// columns and segments cache-dense; -DSCHED_TIME64 makes every arrival,
+// burst, completion and derived time 64-bit for nanosecond traces. Totals of
+// times accumulate in TimeSum, which is wide enough for any n in either build.
+#ifdef SCHED_TIME64
+using SimTime = int64_t;
+using TimeSum = __int128;
+#else
+using SimTime = int32_t;
+using TimeSum = long long;
+#endif
+static const SimTime kTimeMax = numeric_limits<SimTime>::max();
+
 struct Process {
-    int pid;       // 1..N
-    int arrival;   // >= 0
-    int burst;     // > 0
-    int priority;  // smaller = higher priority (used in Priority scheduling)
+    int pid;          // 1..N
+    SimTime arrival;  // >= 0
+    SimTime burst;    // > 0
+    int priority;     // smaller = higher priority (used in Priority scheduling)
 };
 
 struct Segment {
-    int pid;   // -1 for IDLE, else PID
-    int start; // inclusive
-    int end;   // exclusive
+    int pid;        // -1 for IDLE, kSwitchPid for context-switch overhead, else PID
+    SimTime start;  // inclusive
+    SimTime end;    // exclusive
+};
+
+static const int kSwitchPid = -2;
+
+// ---------- Compact timelines ----------
+// A Segment costs 12 bytes (24 with SCHED_TIME64), and RR with a small
+// quantum emits one per slice. CompactTimeline keeps the same sequence as a
+// byte stream of LEB128 varint records:
+//   tag >= 2   segment of PID tag-4 (CS = 2, IDLE = 3), then its length; it
+//              starts where the previous segment ended, so starts are
+//              implicit prefix sums and each end is the next segment's start
+//   tag 0      gap: the clock jumps by a zigzag-coded delta (no segment)
+//   tag 1      copy: the next R segments repeat the (PID, length) of the
+//              segment D back, one for one (varints D, R; R may exceed D)
+// Copies cover RR rotation: while the ready queue is stable, every slice
+// repeats the slice one rotation earlier, so a whole stretch of rotations is
+// one record, and an arrival or completion only costs a plain record before
+// the next copy (whose distance is the new rotation length). The encoder
+// takes the distance from where the PID last ran, O(1) per segment. D is at
+// most kWindow, so the decoder keeps just that many segments of history.
+// Iteration yields Segments by value in time order; nothing is decompressed
+// into a vector. Call finish() before reading.
+
+class CompactTimeline {
+    static const size_t kWindow = 1 << 16; // longest copy distance, in segments
+    struct Item { int pid; SimTime len; };
+
+public:
+    class const_iterator {
+    public:
+        using iterator_category = forward_iterator_tag;
+        using value_type = Segment;
+        using difference_type = ptrdiff_t;
+        using pointer = const Segment*;
+        using reference = const Segment&;
+
+        const Segment& operator*() const { return seg_; }
+        const Segment* operator->() const { return &seg_; }
+        const_iterator& operator++() { if (--left_) decode(); return *this; }
+        bool operator==(const const_iterator& o) const { return left_ == o.left_; }
+        bool operator!=(const const_iterator& o) const { return left_ != o.left_; }
+
+    private:
+        friend class CompactTimeline;
+        const_iterator(const uint8_t *p, size_t left) : p_(p), left_(left) {
+            if (!left_) return;
+            window_.resize(windowFor(left_)); // copies never reach back past the first segment
+            decode();
+        }
+
+        void decode() {
+            while (!copyLeft_) {
+                uint64_t tag = getVarint(p_);
+                if (tag == 0) { clock_ += unzigzag(getVarint(p_)); continue; }
+                if (tag == 1) { copyDist_ = getVarint(p_); copyLeft_ = getVarint(p_); continue; }
+                emit({(int)tag - 4, (SimTime)getVarint(p_)});
+                return;
+            }
+            --copyLeft_;
+            emit(window_[(n_ - copyDist_) & (window_.size() - 1)]);
+        }
+        void emit(Item it) {
+            seg_ = {it.pid, clock_, (SimTime)(clock_ + it.len)};
+            clock_ = seg_.end;
+            window_[n_++ & (window_.size() - 1)] = it;
+        }
+
+        const uint8_t *p_;
+        size_t left_;  // segments not yet passed, counting the current one
+        size_t n_ = 0, copyDist_ = 0, copyLeft_ = 0;
+        SimTime clock_ = 0;
+        Segment seg_{};
+        vector<Item> window_;
+    };
+
+    // Hint: the run emits at most `segments` segments. Reserving only costs
+    // address space until the bytes are written, so the buffer never has to
+    // be regrown (and copied) for typical runs; short runs also get a
+    // smaller history ring.
+    void reserve(size_t segments) {
+        bytes_.reserve(segments * 4);
+        if (ring_.empty()) ring_.resize(windowFor(segments));
+    }
+
+    void push(int pid, SimTime start, SimTime end) {
+        if (ring_.empty()) ring_.resize(kWindow);
+        if (start != clock_) {
+            flushCopy();
+            putVarint(0); putVarint(zigzag((long long)start - clock_));
+            clock_ = start;
+        }
+        SimTime len = end - start;
+        size_t idx = count_, code = (size_t)(pid + 2), mask = ring_.size() - 1;
+        if (code >= lastSeen_.size()) lastSeen_.resize(max(code + 1, 2 * lastSeen_.size()), 0);
+        if (dist_) {
+            const Item &ref = ring_[(idx - dist_) & mask];
+            if (ref.pid == pid && ref.len == len) { ++copied_; record(pid, start, len); return; }
+            flushCopy();
+        }
+        size_t d = lastSeen_[code] ? idx + 1 - lastSeen_[code] : 0;
+        if (d && d <= ring_.size() && ring_[(idx - d) & mask].len == len) { dist_ = d; copied_ = 1; }
+        else literal(pid, len);
+        record(pid, start, len);
+    }
+
+    // Ends the stream and drops the encoder state.
+    void finish() {
+        flushCopy();
+        vector<Item>().swap(ring_);
+        vector<size_t>().swap(lastSeen_);
+    }
+
+    bool empty() const { return count_ == 0; }
+    size_t size() const { return count_; }
+    const Segment& back() const { return last_; }
+    size_t bytes() const { return bytes_.size(); }
+    const_iterator begin() const { return const_iterator(bytes_.data(), count_); }
+    const_iterator end() const { return const_iterator(nullptr, 0); }
+
+private:
+    // Power of two, at least min(n, kWindow)
+    static size_t windowFor(size_t n) {
+        size_t w = 1;
+        while (w < n && w < kWindow) w <<= 1;
+        return w;
+    }
+    static uint64_t zigzag(long long x) { return ((uint64_t)x << 1) ^ (uint64_t)(x >> 63); }
+    static long long unzigzag(uint64_t x) { return (long long)(x >> 1) ^ -(long long)(x & 1); }
+    static uint64_t getVarint(const uint8_t *&p) {
+        uint64_t x = 0;
+        for (int shift = 0;; shift += 7) {
+            uint8_t b = *p++;
+            x |= (uint64_t)(b & 0x7f) << shift;
+            if (!(b & 0x80)) return x;
+        }
+    }
+    void putVarint(uint64_t x) {
+        while (x >= 0x80) { bytes_.push_back((uint8_t)(x | 0x80)); x >>= 7; }
+        bytes_.push_back((uint8_t)x);
+    }
+
+    void literal(int pid, SimTime len) { putVarint((uint64_t)(pid + 4)); putVarint((uint64_t)len); }
+    void record(int pid, SimTime start, SimTime len) {
+        ring_[count_ & (ring_.size() - 1)] = {pid, len};
+        lastSeen_[(size_t)(pid + 2)] = ++count_;
+        clock_ = start + len;
+        last_ = {pid, start, clock_};
+    }
+    // A copy of one segment is no shorter than the segment itself.
+    void flushCopy() {
+        if (copied_ > 1) { putVarint(1); putVarint(dist_); putVarint(copied_); }
+        else if (copied_ == 1) { const Item &it = ring_[(count_ - 1) & (ring_.size() - 1)]; literal(it.pid, it.len); }
+        dist_ = copied_ = 0;
+    }
+
+    vector<uint8_t> bytes_;
+    size_t count_ = 0;
+    Segment last_{};
+    // Encoder state
+    SimTime clock_ = 0;
+    vector<Item> ring_;                        // the last ring_.size() segments
+    vector<size_t> lastSeen_;                  // by pid+2: 1 + index of its latest segment
+    size_t dist_ = 0, copied_ = 0;             // the copy being extended, if any
+};
+
+// ---------- Latency sketches ----------
+// Log-linear (HDR-style) histogram of non-negative times: values below 256 are
+// kept exactly, larger ones fall into one of 128 buckets per power of two
+// (relative error under 1/128). The bucket layout is fixed, so histograms
+// from parallel shards merge by adding counts.
+class LatencyHistogram {
+public:
+    void record(SimTime x) {
+        if (counts_.empty()) counts_.assign(kBuckets, 0);
+        if (x < 0) x = 0;
+        counts_[bucket((uint64_t)x)]++;
+        n_++; sum_ += x; sumSq_ += (unsigned __int128)x * (uint64_t)x;
+        max_ = max(max_, x);
+    }
+    void merge(const LatencyHistogram& o) {
+        if (o.n_ == 0) return;
+        if (counts_.empty()) counts_.assign(kBuckets, 0);
+        for (int b = 0; b < kBuckets; ++b) counts_[b] += o.counts_[b];
+        n_ += o.n_; sum_ += o.sum_; sumSq_ += o.sumSq_;
+        max_ = max(max_, o.max_);
+    }
+    // Allocates the bucket storage now rather than on the first record()
+    void reserve() { if (counts_.empty()) counts_.assign(kBuckets, 0); }
+    // Empties the histogram but keeps its bucket storage
+    void clear() {
+        fill(counts_.begin(), counts_.end(), 0);
+        n_ = 0; sum_ = 0; sumSq_ = 0; max_ = 0;
+    }
+
+    uint64_t count() const { return n_; }
+    TimeSum sum() const { return sum_; }
+    SimTime maximum() const { return max_; }
+    double mean() const { return n_ ? (double)sum_ / n_ : 0.0; }
+    double stddev() const {
+        if (n_ == 0) return 0.0;
+        long double m = (long double)sum_ / n_;
+        long double var = (long double)sumSq_ / n_ - m * m;
+        return var > 0 ? (double)sqrtl(var) : 0.0;
+    }
+    // Nearest-rank quantile, p in (0, 1]: the largest value sharing a bucket
+    // with the ceil(p*n)-th smallest sample (never above maximum()).
+    SimTime quantile(double p) const {
+        if (n_ == 0) return 0;
+        uint64_t rank = (uint64_t)ceil(p * n_);
+        rank = min(max<uint64_t>(rank, 1), n_);
+        uint64_t seen = 0;
+        for (int b = 0; b < kBuckets; ++b) {
+            seen += counts_[b];
+            if (seen >= rank) return (SimTime)min<uint64_t>(highest(b), (uint64_t)max_);
+        }
+        return max_;
+    }
+
+    // Sparse wire form for the distributed grid (see WireWriter): totals, then
+    // only the non-empty buckets.
+    template <class Writer>
+    void encode(Writer& w) const {
+        w.u64(n_); w.i128(sum_); w.i128((__int128)sumSq_); w.i64(max_);
+        uint32_t used = 0;
+        for (uint64_t c : counts_) used += c != 0;
+        w.u32(used);
+        for (int b = 0; b < (int)counts_.size(); ++b)
+            if (counts_[b]) { w.u32((uint32_t)b); w.u64(counts_[b]); }
+    }
+    template <class Reader>
+    void decode(Reader& r) {
+        n_ = r.u64(); sum_ = (TimeSum)r.i128(); sumSq_ = (unsigned __int128)r.i128(); max_ = (SimTime)r.i64();
+        counts_.assign(kBuckets, 0);
+        for (uint32_t used = r.u32(); used > 0; --used) {
+            uint32_t b = r.u32();
+            if (b >= (uint32_t)kBuckets) throw runtime_error("histogram: bucket " + to_string(b) + " out of range");
+            counts_[b] = r.u64();
+        }
+    }
+
+private:
+    static const int kSubBits = 7, kSub = 1 << kSubBits;
+    static const int kBuckets = (8 * (int)sizeof(SimTime) - kSubBits + 1) * kSub;
+
+    static int bucket(uint64_t x) {
+        if (x < 2 * kSub) return (int)x;
+        int e = 63 - __builtin_clzll(x);
+        return (e - kSubBits) * kSub + (int)(x >> (e - kSubBits));
+    }
+    static uint64_t highest(int b) {
+        if (b < 2 * kSub) return (uint64_t)b;
+        int shift = b / kSub - 1;
+        uint64_t mant = b % kSub + kSub;
+        return ((mant + 1) << shift) - 1;
+    }
+
+    vector<uint64_t> counts_; // allocated on first record
+    uint64_t n_ = 0;
+    TimeSum sum_ = 0;
+    unsigned __int128 sumSq_ = 0;
+    SimTime max_ = 0;
+};
+
+// Per-run distributions. fairness() is Jain's index over each process's
+// slowdown (turnaround / burst): 1 when every process is slowed equally,
+// approaching 1/n when one process takes all the delay.
+struct RunStats {
+    LatencyHistogram wait, tat, response;
+    double slowdownSum = 0.0, slowdownSq = 0.0;
+
+    void merge(const RunStats& o) {
+        wait.merge(o.wait); tat.merge(o.tat); response.merge(o.response);
+        slowdownSum += o.slowdownSum; slowdownSq += o.slowdownSq;
+    }
+    void reserve() { wait.reserve(); tat.reserve(); response.reserve(); }
+    void clear() { wait.clear(); tat.clear(); response.clear(); slowdownSum = slowdownSq = 0.0; }
+    double fairness() const {
+        uint64_t n = tat.count();
+        return n && slowdownSq > 0 ? slowdownSum * slowdownSum / (n * slowdownSq) : 1.0;
+    }
 };
 
 struct Result {
     vector<Segment> timeline;            // scheduling timeline
-    vector<int> completion, waiting, tat;// per-pid metrics (indexed by pid, 1..N)
+    vector<SimTime> completion, waiting, tat;// per-pid metrics (indexed by pid, 1..N)
     double avg_wait = 0.0;
     double avg_tat = 0.0;
+    vector<SimTime> response;            // per-pid first dispatch - arrival
+    RunStats stats;                      // distributions of the above
+    size_t switch_count = 0;             // kSwitchPid segments and their total length
+    TimeSum switch_time = 0;
     string algo_name;
+    CompactTimeline packed;              // CompactTimelineSink runs: the timeline (timeline stays empty)
+};
+
+// ---------- Instrumentation ----------
+// Built with -DSCHED_INSTRUMENT, every run* call (and runSMP) records what
+// its engine did -- dispatches, context switches (a different process taking
+// over the CPU with no idle gap between), idle gaps, ready-queue pushes/pops
+// and peak depth, segments -- plus its wall time and the part spent in the
+// metrics pass. Sorting, simulating, metrics and printing are also totalled
+// as phases; batch mode dumps all of it with --counters table|json.
+// Without the flag the probes are empty and SCHED_COUNT expands to nothing.
+
+enum class Phase { Sort, Simulate, Metrics, Print };
+static const int kPhases = 4;
+
+#ifdef SCHED_INSTRUMENT
+struct RunCounters {
+    string name;
+    uint64_t dispatches = 0, switches = 0, idleGaps = 0, segments = 0;
+    uint64_t pushes = 0, pops = 0, maxDepth = 0;
+    int lastPid = -1;
+    double seconds = 0.0, metricsSeconds = 0.0;
+};
+
+struct InstrumentLog {
+    mutex m;
+    vector<RunCounters> runs;
+    double phase[kPhases] = {};
+    uint64_t calls[kPhases] = {};
+
+    void addPhase(Phase p, double s) {
+        lock_guard<mutex> lk(m);
+        phase[(int)p] += s; calls[(int)p]++;
+    }
 };
 
+static InstrumentLog& instrumentLog() {
+    static InstrumentLog log;
+    return log;
+}
+
+// Counters of the run* call in progress on this thread, if any
+static thread_local RunCounters *t_run = nullptr;
+
+#define SCHED_COUNT(...) do { if (RunCounters *cnt = t_run) { __VA_ARGS__; } } while (0)
+
+class PhaseTimer {
+public:
+    explicit PhaseTimer(Phase p) : p_(p), t0_(chrono::steady_clock::now()) {}
+    ~PhaseTimer() {
+        double s = chrono::duration<double>(chrono::steady_clock::now() - t0_).count();
+        if (p_ == Phase::Metrics && t_run) t_run->metricsSeconds += s;
+        instrumentLog().addPhase(p_, s);
+    }
+
+private:
+    Phase p_;
+    chrono::steady_clock::time_point t0_;
+};
+
+// Scope of one run* call; the simulate phase is its time outside metrics.
+class InstrumentedRun {
+public:
+    explicit InstrumentedRun(const string& name) : prev_(t_run), t0_(chrono::steady_clock::now()) {
+        c_.name = name;
+        t_run = &c_;
+    }
+    ~InstrumentedRun() {
+        c_.seconds = chrono::duration<double>(chrono::steady_clock::now() - t0_).count();
+        t_run = prev_;
+        InstrumentLog &log = instrumentLog();
+        log.addPhase(Phase::Simulate, c_.seconds - c_.metricsSeconds);
+        lock_guard<mutex> lk(log.m);
+        log.runs.push_back(move(c_));
+    }
+
+private:
+    RunCounters c_;
+    RunCounters *prev_;
+    chrono::steady_clock::time_point t0_;
+};
+
+static void dumpInstrumentation(bool json) {
+    static const char *names[kPhases] = {"sort", "simulate", "metrics", "print"};
+    InstrumentLog &log = instrumentLog();
+    lock_guard<mutex> lk(log.m);
+    if (json) {
+        cerr << defaultfloat << setprecision(9) << "{\"runs\": [";
+        for (size_t k = 0; k < log.runs.size(); ++k) {
+            const RunCounters &c = log.runs[k];
+            cerr << (k ? ",\n  " : "\n  ") << "{\"name\": \"" << c.name << "\", \"dispatches\": " << c.dispatches
+                 << ", \"context_switches\": " << c.switches << ", \"idle_gaps\": " << c.idleGaps
+                 << ", \"queue_pushes\": " << c.pushes << ", \"queue_pops\": " << c.pops
+                 << ", \"max_queue_depth\": " << c.maxDepth << ", \"segments\": " << c.segments
+                 << ", \"seconds\": " << c.seconds << ", \"metrics_seconds\": " << c.metricsSeconds << "}";
+        }
+        cerr << "],\n \"phases\": {";
+        for (int p = 0; p < kPhases; ++p)
+            cerr << (p ? ", " : "") << "\"" << names[p] << "\": {\"calls\": " << log.calls[p]
+                 << ", \"seconds\": " << log.phase[p] << "}";
+        cerr << "}}\n";
+        return;
+    }
+    cerr << "\nCounters" << string(27, ' ') << "Dispatch  Switches      Idle      Push       Pop  MaxDepth  Segments   Sim ms  Metr ms\n"
+         << string(133, '-') << "\n";
+    for (const RunCounters &c : log.runs) {
+        char line[256];
+        snprintf(line, sizeof line, "%-33.33s %10llu%10llu%10llu%10llu%10llu%10llu%10llu%9.2f%9.2f\n", c.name.c_str(),
+                 (unsigned long long)c.dispatches, (unsigned long long)c.switches, (unsigned long long)c.idleGaps,
+                 (unsigned long long)c.pushes, (unsigned long long)c.pops, (unsigned long long)c.maxDepth,
+                 (unsigned long long)c.segments, (c.seconds - c.metricsSeconds) * 1e3, c.metricsSeconds * 1e3);
+        cerr << line;
+    }
+    cerr << "Phases:";
+    for (int p = 0; p < kPhases; ++p)
+        cerr << " " << names[p] << " " << fixed << setprecision(2) << log.phase[p] * 1e3 << " ms (" << log.calls[p] << ")";
+    cerr << "\n";
+}
+#else
+#define SCHED_COUNT(...) do {} while (0)
+struct PhaseTimer { explicit PhaseTimer(Phase) {} };
+struct InstrumentedRun { explicit InstrumentedRun(const string&) {} };
+#endif
+
+// Sink side of the counters: one call per emitted segment.
+static inline void countSegment(int pid) {
+    (void)pid;
+    SCHED_COUNT(
+        cnt->segments++;
+        if (pid == kSwitchPid) {} // between two processes: not a gap
+        else if (pid < 0) { cnt->idleGaps++; cnt->lastPid = -1; }
+        else {
+            cnt->dispatches++;
+            if (cnt->lastPid >= 0 && cnt->lastPid != pid) cnt->switches++;
+            cnt->lastPid = pid;
+        });
+}
+
+// Read-only column (SoA) view of a process set, as used by every engine.
+// Rows are stored in PID order (pid[r] == r+1); byArrival lists the rows
+// sorted by (arrival, pid). The columns may live in a ProcessColumns or in a
+// memory-mapped process-set file.
+struct ProcessView {
+    size_t n = 0;
+    const int32_t *pid = nullptr;
+    const SimTime *arrival = nullptr, *burst = nullptr;
+    const int32_t *priority = nullptr;
+    const uint32_t *byArrival = nullptr;
+};
+
+// Owning storage behind a ProcessView.
+struct ProcessColumns {
+    vector<int32_t> pid;
+    vector<SimTime> arrival, burst;
+    vector<int32_t> priority;
+    vector<uint32_t> byArrival;
+    vector<uint32_t> sortScratch; // radix sort buffer, kept for refills
+
+    ProcessView view() const {
+        return {pid.size(), pid.data(), arrival.data(), burst.data(), priority.data(), byArrival.data()};
+    }
+};
+
+// Orders c.byArrival (the identity on entry) by (arrival, row); rows are in
+// PID order, so that is (arrival, pid). Small sets use a comparison sort.
+// Larger ones use an LSD radix sort on arrival - min(arrival), 11 bits per
+// pass: the digit histograms come from one sequential sweep, passes whose
+// digit is the same for every row are skipped, and each scatter is stable, so
+// equal arrivals keep row order. Typical traces span well under 2^22 ticks and
+// take two passes instead of the ~n log n gathers of the comparison sort.
+static const size_t kRadixSortMin = 4096;
+static const int kRadixBits = 11, kRadixPasses = (64 + kRadixBits - 1) / kRadixBits;
+
+static void sortByArrival(ProcessColumns& c) {
+    PhaseTimer timer(Phase::Sort);
+    size_t n = c.arrival.size();
+    const SimTime *a = c.arrival.data();
+    if (n < kRadixSortMin) {
+        sort(c.byArrival.begin(), c.byArrival.end(), [&](uint32_t x, uint32_t y){
+            return a[x] != a[y] ? a[x] < a[y] : x < y;
+        });
+        return;
+    }
+    auto range = minmax_element(a, a + n);
+    uint64_t lo = (uint64_t)*range.first, span = (uint64_t)*range.second - lo;
+    int passes = 1;
+    while (passes < kRadixPasses && (span >> (passes * kRadixBits))) passes++;
+    const uint32_t kMask = (1u << kRadixBits) - 1;
+    static thread_local uint32_t count[kRadixPasses][1u << kRadixBits];
+    memset(count, 0, sizeof count[0] * passes);
+    for (size_t r = 0; r < n; ++r) {
+        uint64_t k = (uint64_t)a[r] - lo;
+        for (int p = 0; p < passes; ++p) count[p][(k >> (p * kRadixBits)) & kMask]++;
+    }
+    vector<uint32_t> &src = c.byArrival, &dst = c.sortScratch;
+    dst.resize(n);
+    uint64_t k0 = (uint64_t)a[0] - lo;
+    for (int p = 0; p < passes; ++p) {
+        int shift = p * kRadixBits;
+        if (count[p][(k0 >> shift) & kMask] == n) continue; // constant digit
+        uint32_t pos = 0;
+        for (uint32_t &b : count[p]) { uint32_t k = b; b = pos; pos += k; }
+        for (uint32_t r : src) dst[count[p][(((uint64_t)a[r] - lo) >> shift) & kMask]++] = r;
+        src.swap(dst);
+    }
+}
+
+// PIDs must be dense 1..N (any order); throws otherwise. Fills c in place,
+// reusing its capacity: no allocation once c has held a set this large.
+static void makeColumns(const vector<Process>& ps, ProcessColumns& c) {
+    size_t n = ps.size();
+    c.pid.resize(n); c.arrival.resize(n); c.burst.resize(n); c.priority.resize(n);
+    // byArrival doubles as the seen-set until every row is placed
+    const uint32_t kUnseen = UINT32_MAX;
+    c.byArrival.assign(n, kUnseen);
+    for (const auto &p : ps) {
+        if (p.pid < 1 || (size_t)p.pid > n)
+            throw runtime_error("PID " + to_string(p.pid) + " outside 1.." + to_string(n) + " (PIDs must be dense)");
+        size_t r = p.pid - 1;
+        if (c.byArrival[r] != kUnseen) throw runtime_error("duplicate PID " + to_string(p.pid));
+        c.byArrival[r] = (uint32_t)r;
+        c.pid[r] = p.pid; c.arrival[r] = p.arrival; c.burst[r] = p.burst; c.priority[r] = p.priority;
+    }
+    sortByArrival(c);
+}
+
+static ProcessColumns makeColumns(const vector<Process>& ps) {
+    ProcessColumns c;
+    makeColumns(ps, c);
+    return c;
+}
+
+// Replaces the row of p.pid (which must exist) and moves it to its new place
+// in byArrival: O(n), no re-sort.
+static void updateRow(ProcessColumns& c, const Process& p) {
+    uint32_t r = (uint32_t)(p.pid - 1);
+    auto pos = find(c.byArrival.begin(), c.byArrival.end(), r);
+    c.byArrival.erase(pos);
+    c.arrival[r] = p.arrival; c.burst[r] = p.burst; c.priority[r] = p.priority;
+    auto at = lower_bound(c.byArrival.begin(), c.byArrival.end(), r, [&](uint32_t x, uint32_t y){
+        return c.arrival[x] != c.arrival[y] ? c.arrival[x] < c.arrival[y] : x < y;
+    });
+    c.byArrival.insert(at, r);
+}
+
+// Value ranges accepted for process data (interactive entry and trace files).
+// The 64-bit build takes nanosecond-scale values; in either build the whole
+// set must also fit its time budget (TimeBudget), as completion times are
+// SimTime.
+#ifdef SCHED_TIME64
+static const long long kMaxArrival  = 1'000'000'000'000'000; // ~11.6 days in ns
+static const long long kMaxBurst    = 1'000'000'000'000;     // ~17 min in ns
+#else
+static const long long kMaxArrival  = 1'000'000;
+static const long long kMaxBurst    = 1'000'000;
+#endif
+// Quanta stay int; the largest one worth asking for is the largest burst
+static const long long kMaxQuantum  = min<long long>(kMaxBurst, INT_MAX);
+static const long long kMinPriority = INT_MIN/2;
+static const long long kMaxPriority = INT_MAX/2;
+
+// Whole-set time bound. No engine's clock passes the latest arrival plus the
+// sum of all bursts plus what dispatching charges (see dispatchCharges), so
+// a set whose bound fits SimTime cannot overflow a completion time, while
+// one that does not would wrap silently. Every place that builds a set adds
+// its processes here and checks before anything is simulated.
+struct TimeBudget {
+    TimeSum lastArrival = 0, bursts = 0;
+
+    void add(SimTime arrival, SimTime burst) {
+        lastArrival = max<TimeSum>(lastArrival, arrival);
+        bursts += burst;
+    }
+    TimeSum bound(TimeSum charges = 0) const { return lastArrival + bursts + charges; }
+    bool fits(TimeSum charges = 0) const { return bound(charges) <= kTimeMax; }
+    string error(TimeSum charges = 0) const {
+        ostringstream os;
+        os << "process set runs to t=" << setprecision(4) << (double)bound(charges)
+           << " (latest arrival + all bursts" << (charges ? " + switch charges" : "") << "), past the "
+           << 8 * sizeof(SimTime) << "-bit time limit " << (long long)kTimeMax;
+#ifndef SCHED_TIME64
+        os << "; rebuild with -DSCHED_TIME64";
+#else
+        os << "; split the trace";
+#endif
+        return os.str();
+    }
+    void check(TimeSum charges = 0) const {
+        if (!fits(charges)) throw runtime_error(error(charges));
+    }
+};
+
+static TimeBudget timeBudget(const ProcessView& v) {
+    TimeBudget b;
+    for (size_t r = 0; r < v.n; ++r) b.add(v.arrival[r], v.burst[r]);
+    return b;
+}
+
 // ---------- Input utilities ----------
 static void clearInput() {
     cin.clear();
     cin.ignore(numeric_limits<streamsize>::max(), '\n');
 }
 
-static int readInt(const string &prompt, long long lo, long long hi) {
+static long long readNumber(const string &prompt, long long lo, long long hi) {
     while (true) {
         cout << prompt;
         long long x;
@@ -65,7 +778,7 @@ static int readInt(const string &prompt, long long lo, long long hi) {
                 continue;
             }
             clearInput();
-            return (int)x;
+            return x;
         } else {
             cout << "\n[Error] Invalid number. Try again.\n\n";
             clearInput();
@@ -73,6 +786,9 @@ static int readInt(const string &prompt, long long lo, long long hi) {
     }
 }
 
+static int readInt(const string &prompt, long long lo, long long hi) { return (int)readNumber(prompt, lo, hi); }
+static SimTime readTime(const string &prompt, long long lo, long long hi) { return (SimTime)readNumber(prompt, lo, hi); }
+
 static bool readYesNo(const string &prompt, bool defaultYes = true) {
     while (true) {
         cout << prompt << (defaultYes ? " [Y/n]: " : " [y/N]: ");
@@ -96,22 +812,134 @@ static void printProcessTable(const vector<Process>& ps) {
     }
 }
 
-static void drawGantt(const vector<Segment>& segs) {
+static string segmentLabel(int pid) {
+    return pid == -1 ? "IDLE" : pid == kSwitchPid ? "CS" : "P" + to_string(pid);
+}
+
+// ---- Downsampled timelines ----
+// A timeline folded into a fixed number of equal time spans, so rendering
+// cost depends on the output width rather than the number of segments.
+struct GanttColumn {
+    int pid = -1;             // PID holding most of the span (-1: mostly idle)
+    long long busy = 0;       // non-idle time inside the span (switches count as busy)
+    long long span = 0;       // length of the span
+};
+
+// x * num / den without overflow: a SCHED_TIME64 timeline can be long
+// enough for x * num to pass long long even though the quotient fits.
+static long long scaleTime(long long x, long long num, long long den) {
+    return (long long)((TimeSum)x * num / den);
+}
+
+// Splits [origin, origin + total) into `columns` spans and folds each
+// segment into the spans it overlaps: one pass, O(segments + columns). The
+// dominant PID is a weighted majority vote, exact whenever one PID holds
+// over half of the busy time in its span.
+template <class Timeline>
+static vector<GanttColumn> bucketTimeline(const Timeline& segs, long long total, int columns,
+                                          long long origin = 0) {
+    vector<GanttColumn> col(max(columns, 0));
+    if (columns <= 0 || total <= 0) return col;
+    auto edge = [&](long long c) { return scaleTime(total, c, columns); };
+    for (int c = 0; c < columns; ++c) col[c].span = edge(c+1) - edge(c);
+
+    vector<long long> weight(columns, 0);
+    for (const auto &s : segs) {
+        if (s.pid == -1 || s.end <= s.start) continue;
+        long long t = s.start - origin, end = s.end - origin;
+        for (int c = (int)scaleTime(t, columns, total); t < end && c < columns; ++c) {
+            long long stop = min<long long>(end, edge(c+1));
+            long long d = stop - t;
+            if (d <= 0) continue;
+            GanttColumn &gc = col[c];
+            gc.busy += d;
+            if (gc.pid == s.pid)      weight[c] += d;
+            else if (weight[c] >= d)  weight[c] -= d;
+            else { gc.pid = s.pid; weight[c] = d - weight[c]; }
+            t = stop;
+        }
+    }
+    for (auto &gc : col)
+        if (gc.busy * 2 < gc.span) gc.pid = -1;
+    return col;
+}
+
+// Charts wider than this are drawn downsampled to kGanttColumns columns.
+static const int kGanttMaxWidth = 120;
+static const int kGanttColumns  = 80;
+
+// One character per column: the shade shows the busy share, the label row
+// names the dominant PID of each run of columns.
+template <class Timeline>
+static void drawBucketedGantt(const Timeline& segs, SimTime origin = 0) {
+    long long total = segs.back().end - origin;
+    int cols = (int)min<long long>(kGanttColumns, max(total, 1LL));
+    vector<GanttColumn> col = bucketTimeline(segs, total, cols, origin);
+
+    static const char kShades[] = " .:=+#"; // idle .. fully busy
+    string bar(cols, ' '), labels(cols, ' ');
+    for (int c = 0; c < cols; ++c) {
+        const GanttColumn &gc = col[c];
+        int shade = gc.busy == 0 ? 0 : gc.busy >= gc.span ? 5 : 1 + (int)(4 * gc.busy / max(gc.span, 1LL));
+        bar[c] = kShades[min(shade, 5)];
+    }
+    for (int c = 0; c < cols; ) {
+        int e = c;
+        while (e < cols && col[e].pid == col[c].pid) ++e;
+        string lab = segmentLabel(col[c].pid);
+        if ((int)lab.size() <= e - c) labels.replace(c + (e - c - (int)lab.size()) / 2, lab.size(), lab);
+        c = e;
+    }
+
+    // Ruler: a time every 10 columns, skipping ones that would overlap
+    string ruler(cols + 24, ' ');
+    int freeFrom = 0;
+    auto mark = [&](int c) {
+        if (c < freeFrom) return;
+        string t = to_string(origin + scaleTime(total, c, cols));
+        ruler.replace(c, t.size(), t);
+        freeFrom = c + (int)t.size() + 1;
+    };
+    for (int c = 0; c < cols; c += 10) mark(c);
+    mark(cols);
+    ruler.erase(ruler.find_last_not_of(' ') + 1);
+
+    cout << "\nGantt Chart (" << segs.size() << " segments in " << cols
+         << " columns of ~" << total / cols + (total % cols != 0)
+         << " time units; shade " << kShades + 1 << " = busy share):\n";
+    cout << "|" << bar << "|\n";
+    cout << "|" << labels << "|\n";
+    cout << ruler << "\n";
+}
+
+// `origin` is where the first segment starts when drawing a window of a
+// longer timeline (ResultInspector); whole timelines start at 0. Timeline is
+// a vector<Segment> or a CompactTimeline.
+template <class Timeline>
+static void drawGantt(const Timeline& segs, SimTime origin = 0) {
     if (segs.empty()) { cout << "\n[Gantt] (no segments)\n"; return; }
 
-    int total = segs.back().end;
+    SimTime total = segs.back().end - origin;
     double scale = (total > 80) ? (double)total / 80.0 : 1.0; // compress long timelines
 
+    // Every segment gets at least one column, so long timelines would be
+    // wider than any terminal: downsample those instead.
+    size_t width = 1;
+    for (const auto &s : segs) {
+        width += 1 + max(1, (int)round(max<SimTime>(0, s.end - s.start) / scale));
+        if (width > (size_t)kGanttMaxWidth) { drawBucketedGantt(segs, origin); return; }
+    }
+
     // Build two rows: a bar and a label row
     string bar, labels;
     for (const auto &s : segs) {
-        int duration = max(0, s.end - s.start);
+        SimTime duration = max<SimTime>(0, s.end - s.start);
         int w = max(1, (int)round(duration / scale));
         bar += "|";
         bar += string(w, '-');
 
         labels += "|";
-        string lab = (s.pid == -1) ? "IDLE" : ("P" + to_string(s.pid));
+        string lab = segmentLabel(s.pid);
         if (w >= (int)lab.size()) {
             int left = (w - (int)lab.size()) / 2;
             int right = w - (int)lab.size() - left;
@@ -120,57 +948,4381 @@ static void drawGantt(const vector<Segment>& segs) {
             labels += string(w, ' ');
         }
     }
-    bar += "|"; labels += "|";
-
-    cout << "\nGantt Chart (scaled):\n";
-    cout << bar << "\n";
-    cout << labels << "\n";
-
-    // Time ruler
-    cout << "0";
-    int printed = 0;
-    for (const auto &s : segs) {
-        int duration = max(0, s.end - s.start);
-        int w = max(1, (int)round(duration / scale));
-        string t = to_string(s.end);
-        int spaces = w + 1 - (int)t.size(); // +1 for the vertical bar
-        if (spaces < 1) spaces = 1;
-        cout << string(spaces, ' ') << t;
-        printed += spaces + (int)t.size();
-    }
-    cout << "\n";
+    bar += "|"; labels += "|";
+
+    cout << "\nGantt Chart (scaled):\n";
+    cout << bar << "\n";
+    cout << labels << "\n";
+
+    // Time ruler
+    string first = to_string(origin);
+    cout << first;
+    int printed = 0, overrun = (int)first.size() - 1; // a wide start label eats into the first gap
+    for (const auto &s : segs) {
+        SimTime duration = max<SimTime>(0, s.end - s.start);
+        int w = max(1, (int)round(duration / scale));
+        string t = to_string(s.end);
+        int spaces = w + 1 - (int)t.size() - overrun; // +1 for the vertical bar
+        overrun = 0;
+        if (spaces < 1) spaces = 1;
+        cout << string(spaces, ' ') << t;
+        printed += spaces + (int)t.size();
+    }
+    cout << "\n";
+}
+
+// Table columns holding times. SCHED_TIME64 sizes them for a 19-digit
+// SimTime; every value is also preceded (right-aligned) or followed
+// (left-aligned) by at least one space, so one that outgrows its column
+// still stands apart from its neighbour.
+#ifdef SCHED_TIME64
+static const int kMetricWidths[7] = {6, 20, 20, 20, 20, 20, 20}; // PID, then six times
+static const int kDistWidth = 20, kDistMeanWidth = 24;
+#else
+static const int kMetricWidths[7] = {6, 10, 8, 11, 12, 9, 9};
+static const int kDistWidth = 10, kDistMeanWidth = 12;
+#endif
+
+static void printDistributions(const RunStats &st) {
+    const int w = kDistWidth, m = kDistMeanWidth;
+    cout << "\nDistribution" << right << setw(w) << "p50" << setw(w) << "p90" << setw(w) << "p99"
+         << setw(w) << "p99.9" << setw(w) << "Max" << setw(m) << "Mean" << setw(m) << "Stddev" << "\n";
+    cout << string(12 + 5*w + 2*m, '-') << "\n";
+    auto row = [&](const char *name, const LatencyHistogram &h) {
+        cout << left << setw(12) << name << right
+             << ' ' << setw(w-1) << h.quantile(0.50) << ' ' << setw(w-1) << h.quantile(0.90)
+             << ' ' << setw(w-1) << h.quantile(0.99) << ' ' << setw(w-1) << h.quantile(0.999)
+             << ' ' << setw(w-1) << h.maximum() << fixed << setprecision(2)
+             << ' ' << setw(m-1) << h.mean() << ' ' << setw(m-1) << h.stddev() << "\n";
+    };
+    row("Waiting", st.wait);
+    row("Turnaround", st.tat);
+    row("Response", st.response);
+    cout << fixed << setprecision(3) << "Jain's fairness (turnaround/burst): " << st.fairness() << "\n";
+}
+
+// Runs with more processes than this skip the per-process table unless
+// asked for it (batch --table); the averages and distributions still print.
+static const size_t kMaxTableRows = 1000;
+
+static void printMetricsHeader() {
+    static const char *const names[7] = {"PID", "Arrival", "Burst", "Complete", "Turnaround", "Waiting", "Response"};
+    cout << left;
+    for (int c = 0; c < 7; ++c) cout << setw(kMetricWidths[c]) << names[c];
+    cout << "\n" << string(accumulate(kMetricWidths, kMetricWidths + 7, 0), '-') << "\n";
+}
+
+// Rows for PIDs first..last (inclusive), in the columns of printMetricsHeader.
+// Rows are formatted into one buffer and written in blocks, which is far
+// cheaper than setw per field. Rows are stored in PID order, so row pid-1
+// holds that process.
+static void printMetricRows(const Result &res, const ProcessView& v, size_t first, size_t last) {
+    string buf;
+    buf.reserve(1 << 16);
+    char row[192];
+    const int *w = kMetricWidths;
+    for (size_t pid = first; pid <= last; ++pid) {
+        int len = snprintf(row, sizeof row, "%-*zu %-*lld %-*lld %-*lld %-*lld %-*lld %-*lld\n", w[0] - 1, pid,
+                           w[1] - 1, (long long)v.arrival[pid-1], w[2] - 1, (long long)v.burst[pid-1],
+                           w[3] - 1, (long long)res.completion[pid], w[4] - 1, (long long)res.tat[pid],
+                           w[5] - 1, (long long)res.waiting[pid], w[6] - 1, (long long)res.response[pid]);
+        buf.append(row, len);
+        if (buf.size() > (1 << 16) - sizeof row) { cout.write(buf.data(), buf.size()); buf.clear(); }
+    }
+    cout.write(buf.data(), buf.size());
+}
+
+static void printProcessMetrics(const Result &res, const ProcessView& v, bool fullTable = false) {
+    size_t n = res.completion.empty() ? 0 : res.completion.size() - 1;
+    if (n <= kMaxTableRows || fullTable) {
+        cout << "\nPer-Process Metrics:\n";
+        printMetricsHeader();
+        printMetricRows(res, v, 1, n);
+    } else {
+        cout << "\n[Info] Per-process table omitted for " << n
+             << " processes (batch --inspect pages through it, --table prints it,"
+                " --export writes it).\n";
+    }
+
+    cout << fixed << setprecision(2);
+    cout << "\nAverage Waiting Time   : " << res.avg_wait << "\n";
+    cout << "Average Turnaround Time: " << res.avg_tat << "\n";
+    if (res.switch_count > 0) {
+        SimTime makespan = *max_element(res.completion.begin(), res.completion.end());
+        cout << "Context Switch Overhead: " << (long long)res.switch_time << " time units over "
+             << res.switch_count << " switches (" << (makespan > 0 ? 100.0 * (double)res.switch_time / makespan : 0.0)
+             << "% of the schedule)\n";
+    }
+    printDistributions(res.stats);
+    cout << "\n";
+}
+
+static void printResult(const Result &res, const ProcessView& v, bool fullTable = false) {
+    PhaseTimer timer(Phase::Print);
+    cout << "\n=== " << res.algo_name << " Result ===\n";
+    if (!res.packed.empty()) drawGantt(res.packed);
+    else drawGantt(res.timeline);
+    printProcessMetrics(res, v, fullTable);
+}
+
+// ---------- Metric kernels ----------
+// tat = completion - arrival and wait = tat - burst, each clamped at 0, over
+// the SoA columns, plus the sums behind the averages. completion is 1-based (indexed by PID) like Result; arrival
+// and burst are the view's 0-based rows. Sums are exact integers (TimeSum),
+// so every kernel produces identical results (and the same averages as
+// summing in doubles). The vector kernels exist for the 32-bit time domain.
+
+struct MetricSums {
+    TimeSum sumWait = 0, sumTat = 0;
+};
+
+// Rows [from, n); also the tail of the vector kernels.
+static void metricsScalar(const SimTime *comp, const SimTime *arrival, const SimTime *burst,
+                          SimTime *tat, SimTime *wait, size_t from, size_t n, MetricSums &s) {
+    for (size_t k = from; k < n; ++k) {
+        SimTime t = comp[k+1] - arrival[k];
+        SimTime w = t - burst[k];
+        if (t < 0) t = 0; // safety
+        if (w < 0) w = 0; // safety for malformed inputs
+        tat[k+1] = t; wait[k+1] = w;
+        s.sumTat += t; s.sumWait += w;
+    }
+}
+
+#if SCHED_SIMD_AVX2
+// Not built with -mavx2, so this is compiled for AVX2 separately and only
+// called when the CPU reports it.
+__attribute__((target("avx2")))
+static void metricsAvx2(const int *comp, const int32_t *arrival, const int32_t *burst,
+                        int *tat, int *wait, size_t n, MetricSums &s) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i sumT = zero, sumW = zero;
+    size_t k = 0;
+    for (; k + 8 <= n; k += 8) {
+        __m256i c = _mm256_loadu_si256((const __m256i*)(comp + k + 1));
+        __m256i a = _mm256_loadu_si256((const __m256i*)(arrival + k));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(burst + k));
+        __m256i t = _mm256_sub_epi32(c, a);
+        __m256i w = _mm256_max_epi32(_mm256_sub_epi32(t, b), zero);
+        t = _mm256_max_epi32(t, zero);
+        _mm256_storeu_si256((__m256i*)(tat + k + 1), t);
+        _mm256_storeu_si256((__m256i*)(wait + k + 1), w);
+        // Widen to 64-bit lanes before summing
+        sumT = _mm256_add_epi64(sumT, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(t)));
+        sumT = _mm256_add_epi64(sumT, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(t, 1)));
+        sumW = _mm256_add_epi64(sumW, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(w)));
+        sumW = _mm256_add_epi64(sumW, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(w, 1)));
+    }
+    alignas(32) long long st[4], sw[4];
+    _mm256_store_si256((__m256i*)st, sumT); _mm256_store_si256((__m256i*)sw, sumW);
+    for (int l = 0; l < 4; ++l) { s.sumTat += st[l]; s.sumWait += sw[l]; }
+    metricsScalar(comp, arrival, burst, tat, wait, k, n, s);
+}
+#endif
+
+#if SCHED_SIMD_NEON
+static void metricsNeon(const int *comp, const int32_t *arrival, const int32_t *burst,
+                        int *tat, int *wait, size_t n, MetricSums &s) {
+    const int32x4_t zero = vdupq_n_s32(0);
+    int64x2_t sumT = vdupq_n_s64(0), sumW = vdupq_n_s64(0);
+    size_t k = 0;
+    for (; k + 4 <= n; k += 4) {
+        int32x4_t t = vsubq_s32(vld1q_s32(comp + k + 1), vld1q_s32(arrival + k));
+        int32x4_t w = vmaxq_s32(vsubq_s32(t, vld1q_s32(burst + k)), zero);
+        t = vmaxq_s32(t, zero);
+        vst1q_s32(tat + k + 1, t);
+        vst1q_s32(wait + k + 1, w);
+        sumT = vpadalq_s32(sumT, t); // pairwise widen-and-add into 64-bit lanes
+        sumW = vpadalq_s32(sumW, w);
+    }
+    s.sumTat += vgetq_lane_s64(sumT, 0) + vgetq_lane_s64(sumT, 1);
+    s.sumWait += vgetq_lane_s64(sumW, 0) + vgetq_lane_s64(sumW, 1);
+    metricsScalar(comp, arrival, burst, tat, wait, k, n, s);
+}
+#endif
+
+// Fills r.tat/r.waiting (sized n+1) from r.completion and returns the sums.
+static MetricSums reduceMetrics(Result &r, const ProcessView &v) {
+    MetricSums s;
+    const SimTime *comp = r.completion.data();
+    SimTime *tat = r.tat.data(), *wait = r.waiting.data();
+#if SCHED_SIMD_NEON
+    metricsNeon(comp, v.arrival, v.burst, tat, wait, v.n, s);
+#elif SCHED_SIMD_AVX2
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    if (avx2) metricsAvx2(comp, v.arrival, v.burst, tat, wait, v.n, s);
+    else      metricsScalar(comp, v.arrival, v.burst, tat, wait, 0, v.n, s);
+#else
+    metricsScalar(comp, v.arrival, v.burst, tat, wait, 0, v.n, s);
+#endif
+    return s;
+}
+
+// Completes a Result whose completion times and first dispatch times (in
+// r.response) are filled in: per-process waiting/turnaround/response, the
+// averages, and one streaming pass into the distribution sketches.
+static void computeMetrics(Result &r, const ProcessView &v) {
+    size_t n = v.n;
+    r.completion.resize(n+1, 0);
+    r.response.resize(n+1, kTimeMax);
+    r.waiting.resize(n+1);
+    r.tat.resize(n+1);
+    MetricSums s = reduceMetrics(r, v);
+    if (n > 0) { r.avg_wait = (double)s.sumWait / n; r.avg_tat = (double)s.sumTat / n; }
+
+    RunStats &st = r.stats;
+    for (size_t k = 0; k < n; ++k) {
+        int pid = (int)k + 1;
+        SimTime first = r.response[pid];
+        r.response[pid] = first == kTimeMax ? 0 : max<SimTime>(0, first - v.arrival[k]);
+        st.wait.record(r.waiting[pid]);
+        st.tat.record(r.tat[pid]);
+        st.response.record(r.response[pid]);
+        double slow = (double)r.tat[pid] / v.burst[k];
+        st.slowdownSum += slow; st.slowdownSq += slow * slow;
+    }
+}
+
+// ---------- Metrics ----------
+// Recomputes every metric of r from the timeline tl (r.timeline or
+// r.packed), overwriting r's earlier contents but keeping the capacity of
+// its vectors.
+template <class Timeline>
+static void metricsFromSegments(Result& r, const ProcessView& v, const Timeline& tl) {
+    r.completion.assign(v.n+1, 0);
+    r.response.assign(v.n+1, kTimeMax);
+    r.avg_wait = r.avg_tat = 0.0;
+    r.switch_count = 0; r.switch_time = 0;
+    r.stats.clear();
+
+    // Completion time = last end occurrence in timeline for that PID,
+    // first dispatch = earliest start
+    for (const auto &s : tl) {
+        if (s.pid < 0) {
+            if (s.pid == kSwitchPid) { r.switch_count++; r.switch_time += s.end - s.start; }
+            continue;
+        }
+        r.completion[s.pid] = max(r.completion[s.pid], s.end);
+        r.response[s.pid] = min(r.response[s.pid], s.start);
+    }
+
+    computeMetrics(r, v);
+}
+
+static void metricsFromTimeline(Result& r, const ProcessView& v) { metricsFromSegments(r, v, r.timeline); }
+
+// Takes ownership of the timeline; it ends up in Result::timeline uncopied.
+static Result finalizeMetrics(const string& name, const ProcessView& v, vector<Segment>&& tl) {
+    PhaseTimer timer(Phase::Metrics);
+    Result r; r.algo_name = name; r.timeline = move(tl);
+    metricsFromTimeline(r, v);
+    return r;
+}
+
+// Same for a compact timeline, which ends up in Result::packed.
+static Result finalizeMetrics(const string& name, const ProcessView& v, CompactTimeline&& tl) {
+    PhaseTimer timer(Phase::Metrics);
+    Result r; r.algo_name = name;
+    tl.finish();
+    r.packed = move(tl);
+    metricsFromSegments(r, v, r.packed);
+    return r;
+}
+
+// ---------- Timeline arena ----------
+// Timeline buffers outlive the runs that fill them: TimelineSink starts from a
+// recycled buffer whose capacity survives earlier runs, and recycleTimeline()
+// hands a finished Result's buffer back. Repeated runs (menu, sweeps) then
+// stop reallocating multi-million-segment timelines.
+
+class SegmentArena {
+public:
+    vector<Segment> acquire(size_t capacity) {
+        vector<Segment> tl;
+        {
+            lock_guard<mutex> lk(m_);
+            if (!free_.empty()) { tl = move(free_.back()); free_.pop_back(); }
+        }
+        tl.clear();
+        // Untouched capacity costs address space, not resident memory, so
+        // reserving the engine's upper bound avoids regrowth copies.
+        if (tl.capacity() < capacity) { vector<Segment>().swap(tl); tl.reserve(capacity); }
+        return tl;
+    }
+    void release(vector<Segment>&& tl) {
+        if (tl.capacity() == 0) return;
+        lock_guard<mutex> lk(m_);
+        if (free_.size() < kMaxBuffers) { free_.push_back(move(tl)); return; }
+        auto smallest = min_element(free_.begin(), free_.end(), [](const vector<Segment>& a, const vector<Segment>& b){
+            return a.capacity() < b.capacity();
+        });
+        if (smallest->capacity() < tl.capacity()) *smallest = move(tl);
+    }
+
+private:
+    static const size_t kMaxBuffers = 4;
+    mutex m_;
+    vector<vector<Segment>> free_;
+};
+
+static SegmentArena& timelineArena() {
+    static SegmentArena arena;
+    return arena;
+}
+
+// Call once a Result has been printed/exported to reuse its timeline storage.
+static void recycleTimeline(Result&& r) {
+    timelineArena().release(move(r.timeline));
+}
+
+// ---------- Run sinks ----------
+// Engines report through a compile-time Sink policy:
+//   bool segment(int pid, SimTime start, SimTime end, bool finished)
+// is called for every segment in time order (pid -1 for IDLE; finished marks
+// the process's last segment) and returns false to abandon the run.
+// Sinks are constructed from the run's ProcessView; expect(k) is a hint that
+// the run emits at most k segments, and Result result(name, view) then builds
+// the run's Result.
+
+// Records the full timeline (Gantt chart + metrics).
+struct TimelineSink {
+    vector<Segment> tl;
+
+    explicit TimelineSink(const ProcessView&) {}
+    void expect(size_t segments) { tl = timelineArena().acquire(segments); }
+    bool segment(int pid, SimTime start, SimTime end, bool) {
+        countSegment(pid);
+        tl.push_back({pid, start, end});
+        return true;
+    }
+    Result result(const string& name, const ProcessView& v) { return finalizeMetrics(name, v, move(tl)); }
+};
+
+// Records the timeline as a CompactTimeline (batch --compact): the same
+// segments and metrics in a fraction of the memory for sliced runs.
+struct CompactTimelineSink {
+    CompactTimeline tl;
+
+    explicit CompactTimelineSink(const ProcessView&) {}
+    void expect(size_t segments) { tl.reserve(segments); }
+    bool segment(int pid, SimTime start, SimTime end, bool) {
+        countSegment(pid);
+        tl.push(pid, start, end);
+        return true;
+    }
+    Result result(const string& name, const ProcessView& v) { return finalizeMetrics(name, v, move(tl)); }
+};
+
+// Metrics only: first dispatch and completion times are recorded as the run
+// goes and the rest comes from the same code as finalizeMetrics. No timeline
+// is allocated, so Result::timeline stays empty.
+struct MetricsSink {
+    Result r;
+
+    explicit MetricsSink(const ProcessView& v) {
+        r.completion.assign(v.n+1, 0);
+        r.response.assign(v.n+1, kTimeMax);
+    }
+    void expect(size_t) {}
+    bool segment(int pid, SimTime start, SimTime end, bool finished) {
+        countSegment(pid);
+        if (pid < 0) {
+            if (pid == kSwitchPid) { r.switch_count++; r.switch_time += end - start; }
+            return true;
+        }
+        r.response[pid] = min(r.response[pid], start);
+        if (finished) r.completion[pid] = end;
+        return true;
+    }
+    Result result(const string& name, const ProcessView& v) {
+        PhaseTimer timer(Phase::Metrics);
+        r.algo_name = name;
+        computeMetrics(r, v);
+        return move(r);
+    }
+};
+
+// ---------- Algorithms ----------
+// Every engine reads a ProcessView and walks it in byArrival order. Callers
+// build the columns (and so the arrival order) once per process set and hand
+// the same view to every run; the heaps key on burst or priority inline, so
+// no engine needs a second ordering. Each simulate* core returns false if the
+// sink abandoned the run.
+
+struct ReadyEntry;
+
+// Scheduler state between two dispatches, as saved by the FCFS, heap and RR
+// cores for incremental re-simulation (see IncrementalRun). It only covers
+// processes admitted so far (the first `cursor` entries of byArrival), so it
+// stays valid after an edit to any process arriving later than `time`.
+struct EngineCheckpoint {
+    SimTime time = 0;
+    size_t cursor = 0, finished = 0;
+    size_t segments = 0;          // segments emitted before this point
+    vector<ReadyEntry> ready;     // heap cores: heap storage as laid out
+    vector<pair<int,SimTime>> queue; // RR: (pid, remaining) in queue order
+    int lastPid = 0;              // SwitchCost state
+    bool loaded = false;
+};
+
+// Checkpoint policy of a core run: NoCheckpoints compiles away; the recorder
+// keeps one checkpoint every `every` segments.
+struct NoCheckpoints {
+    bool due(size_t) const { return false; }
+    void save(EngineCheckpoint&&) {}
+};
+
+struct CheckpointRecorder {
+    vector<EngineCheckpoint> *out;
+    size_t every, next;
+
+    bool due(size_t segments) const { return segments >= next; }
+    void save(EngineCheckpoint&& cp) { next = cp.segments + every; out->push_back(move(cp)); }
+};
+
+// Dispatch overhead of a core run. A context switch costs `cost` whenever
+// the CPU starts a process that is not already loaded on it, plus `warmup`
+// (cold caches) when that process is not the one that ran last; an idle gap
+// unloads the process but leaves its cache warm. The charged time goes into
+// the timeline as a kSwitchPid segment in front of the dispatch and delays
+// everything behind it, so it shows in waiting and turnaround times.
+// NoSwitchCost charges a constant 0 and compiles to the plain loop.
+struct DispatchCost {
+    SimTime cost = 0, warmup = 0;
+    bool none() const { return cost == 0 && warmup == 0; }
+};
+
+// Worst-case overhead of a run over v: every dispatch charges at most
+// cost + warmup. With a quantum (the smallest one the run uses) a process is
+// dispatched at most once per slice plus once after an arrival cut a slice
+// short; without one, at most twice (its start, and a resume after one
+// preemption per arrival).
+static TimeSum dispatchCharges(const ProcessView& v, const DispatchCost& dc, int quantum) {
+    if (dc.none()) return 0;
+    TimeSum dispatches = 2 * (TimeSum)v.n;
+    if (quantum > 0) {
+        dispatches = v.n;
+        for (size_t r = 0; r < v.n; ++r) dispatches += ((TimeSum)v.burst[r] + quantum - 1) / quantum;
+    }
+    return dispatches * ((TimeSum)dc.cost + dc.warmup);
+}
+
+// Throws if a run charging dc could overflow SimTime (see TimeBudget).
+static void checkDispatchBudget(const ProcessView& v, const DispatchCost& dc, int quantum) {
+    if (!dc.none()) timeBudget(v).check(dispatchCharges(v, dc, quantum));
+}
+
+struct NoSwitchCost {
+    static constexpr SimTime charge(int) { return 0; }
+    void idle() {}
+    void save(EngineCheckpoint&) const {}
+    void restore(const EngineCheckpoint&) {}
+};
+
+struct SwitchCost {
+    DispatchCost dc;
+    int last = 0;        // PID that ran last (0: none yet)
+    bool loaded = false; // ...and is still on the CPU
+
+    SimTime charge(int pid) {
+        if (loaded && pid == last) return 0;
+        SimTime c = dc.cost + (pid != last ? dc.warmup : 0);
+        last = pid; loaded = true;
+        return c;
+    }
+    void idle() { loaded = false; }
+    void save(EngineCheckpoint& cp) const { cp.lastPid = last; cp.loaded = loaded; }
+    void restore(const EngineCheckpoint& cp) { last = cp.lastPid; loaded = cp.loaded; }
+};
+
+// from (optional): resume at a checkpoint taken by an earlier run.
+template <class Sink, class Hook = NoCheckpoints, class Switch = NoSwitchCost>
+static bool simulateFCFS(const ProcessView& v, Sink& sink, Hook hook = Hook(), const EngineCheckpoint* from = nullptr,
+                         Switch sw = Switch()) {
+    SimTime t = from ? from->time : 0;
+    size_t emitted = from ? from->segments : 0;
+    if (from) sw.restore(*from);
+    for (size_t k = from ? from->cursor : 0; k < v.n; ++k) {
+        if (hook.due(emitted)) {
+            EngineCheckpoint cp; cp.time = t; cp.cursor = cp.finished = k; cp.segments = emitted;
+            sw.save(cp);
+            hook.save(move(cp));
+        }
+        uint32_t r = v.byArrival[k];
+        if (t < v.arrival[r]) { // idle gap
+            if (!sink.segment(-1, t, v.arrival[r], false)) return false;
+            t = v.arrival[r]; emitted++;
+            sw.idle();
+        }
+        if (SimTime c = sw.charge(v.pid[r])) {
+            if (!sink.segment(kSwitchPid, t, t + c, false)) return false;
+            t += c; emitted++;
+        }
+        if (!sink.segment(v.pid[r], t, t + v.burst[r], true)) return false;
+        t += v.burst[r]; emitted++;
+    }
+    return true;
+}
+
+// Ready queue shared by the heap-based engines: a binary min-heap of
+// (key, arrival, pid) tuples. The key is stored inline so comparisons never
+// chase the columns, and the storage is reserved once for n entries.
+struct ReadyEntry {
+    long long key;  // policy's primary key (burst, priority, remaining, ...)
+    SimTime arrival;
+    int pid;
+};
+
+static bool readyBefore(const ReadyEntry& x, const ReadyEntry& y) {
+    if (x.key != y.key) return x.key < y.key;
+    if (x.arrival != y.arrival) return x.arrival < y.arrival;
+    return x.pid < y.pid;
+}
+
+// Entry is ReadyEntry for the engines; any type with a readyBefore()
+// overload works (the online scheduler keys by submission order instead).
+template <class Entry>
+class BasicReadyHeap {
+public:
+    BasicReadyHeap() = default;
+    explicit BasicReadyHeap(size_t cap) { h_.reserve(cap); }
+    void reset(size_t cap) { h_.clear(); h_.reserve(cap); }
+    // Raw storage, for checkpoints: assign() takes back what entries() gave
+    const vector<Entry>& entries() const { return h_; }
+    void assign(const vector<Entry>& h) { h_.assign(h.begin(), h.end()); }
+    bool empty() const { return h_.empty(); }
+    size_t size() const { return h_.size(); }
+    const Entry& top() const { return h_.front(); }
+    void push(const Entry& e) {
+        h_.push_back(e); push_heap(h_.begin(), h_.end(), after);
+        SCHED_COUNT(cnt->pushes++; cnt->maxDepth = max<uint64_t>(cnt->maxDepth, h_.size()));
+    }
+    Entry pop() {
+        SCHED_COUNT(cnt->pops++);
+        pop_heap(h_.begin(), h_.end(), after);
+        Entry e = h_.back(); h_.pop_back();
+        return e;
+    }
+
+private:
+    // std heap keeps the "largest" on top, so order by the inverse
+    static bool after(const Entry& x, const Entry& y) { return readyBefore(y, x); }
+    vector<Entry> h_;
+};
+
+using ReadyHeap = BasicReadyHeap<ReadyEntry>;
+
+// FIFO of PIDs on a ring buffer with O(1) push/pop at either end. Each PID
+// is queued at most once, so a ring sized for n never grows; smaller rings
+// (per-CPU queues) double when full.
+struct PidRing {
+    vector<int> buf;
+    size_t head = 0, count = 0;
+
+    PidRing() = default;
+    explicit PidRing(size_t cap) : buf(max<size_t>(cap, 1)) {}
+    // Empties the ring, growing it to at least cap slots (never shrinking)
+    void reset(size_t cap) {
+        if (buf.size() < cap) buf.assign(cap, 0);
+        head = count = 0;
+    }
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+    int at(size_t k) const { // k-th from the front
+        size_t p = head + k;
+        return buf[p >= buf.size() ? p - buf.size() : p];
+    }
+    void push(int pid) {
+        if (count == buf.size()) grow();
+        size_t tail = head + count;
+        if (tail >= buf.size()) tail -= buf.size();
+        buf[tail] = pid; ++count;
+        SCHED_COUNT(cnt->pushes++; cnt->maxDepth = max<uint64_t>(cnt->maxDepth, count));
+    }
+    int pop() {
+        SCHED_COUNT(cnt->pops++);
+        int pid = buf[head];
+        if (++head == buf.size()) head = 0;
+        --count;
+        return pid;
+    }
+    int popBack() {
+        SCHED_COUNT(cnt->pops++);
+        size_t tail = head + count - 1;
+        if (tail >= buf.size()) tail -= buf.size();
+        --count;
+        return buf[tail];
+    }
+
+private:
+    void grow() {
+        vector<int> next(max<size_t>(buf.size() * 2, 16));
+        for (size_t k = 0; k < count; ++k) {
+            size_t at = head + k;
+            next[k] = buf[at >= buf.size() ? at - buf.size() : at];
+        }
+        buf.swap(next); head = 0;
+    }
+};
+
+// Fenwick tree over per-row ticket counts for lottery scheduling: adding or
+// removing a process's tickets and finding the holder of ticket u are
+// O(log n), and reset() reuses the storage.
+struct TicketTree {
+    vector<uint64_t> tree; // 1-based partial sums
+    uint64_t sum = 0;
+    size_t top = 0;        // highest power of two <= n
+
+    void reset(size_t n) {
+        tree.assign(n + 1, 0); sum = 0;
+        top = n ? size_t(1) << (63 - __builtin_clzll(n)) : 0;
+    }
+    uint64_t total() const { return sum; }
+    void add(size_t row, long long tickets) {
+        sum += (uint64_t)tickets;
+        for (size_t k = row + 1; k < tree.size(); k += k & (0 - k)) tree[k] += (uint64_t)tickets;
+    }
+    // Row holding ticket u (0 <= u < total()): descends from the largest
+    // power of two, skipping every prefix whose tickets all lie below u.
+    size_t find(uint64_t u) const {
+        size_t k = 0;
+        for (size_t step = top; step; step >>= 1)
+            if (k + step < tree.size() && tree[k + step] <= u) { k += step; u -= tree[k]; }
+        return k;
+    }
+};
+
+// Working storage of the heap, RR and MLFQ cores. A core called without one
+// uses a local instance; callers that keep one across runs (SimulationContext,
+// sweep and Monte Carlo workers) reuse its capacity, so repeated runs over
+// sets of similar size allocate nothing here.
+struct EngineScratch {
+    ReadyHeap heap;
+    PidRing ring;
+    vector<SimTime> rem;
+    vector<bool> inQueue;
+    vector<int> quanta;
+    vector<PidRing> levels;
+    TicketTree tickets;
+};
+
+
+// Shared core for the non-preemptive "pick the best ready job" policies.
+// Processes are admitted through a cursor over the arrival-sorted order into
+// the ready heap under key(row), ties broken by arrival and then pid, so the
+// whole run is O(n log n) and no memory is allocated per dispatch.
+template <class Key, class Sink, class Hook = NoCheckpoints, class Switch = NoSwitchCost>
+static bool simulateReadyHeap(const ProcessView& v, Key key, Sink& sink, Hook hook = Hook(),
+                              const EngineCheckpoint* from = nullptr, Switch sw = Switch(),
+                              EngineScratch* scratch = nullptr) {
+    size_t n = v.n;
+    EngineScratch local;
+    ReadyHeap &heap = (scratch ? *scratch : local).heap;
+    heap.reset(n);
+
+    SimTime t = 0; size_t i = 0; size_t finished = 0; size_t emitted = 0;
+    if (from) {
+        t = from->time; i = from->cursor; finished = from->finished; emitted = from->segments;
+        heap.assign(from->ready);
+        sw.restore(*from);
+    }
+
+    while (finished < n) {
+        if (hook.due(emitted)) {
+            EngineCheckpoint cp;
+            cp.time = t; cp.cursor = i; cp.finished = finished; cp.segments = emitted;
+            cp.ready = heap.entries();
+            sw.save(cp);
+            hook.save(move(cp));
+        }
+        while (i < n && v.arrival[v.byArrival[i]] <= t) {
+            uint32_t r = v.byArrival[i++];
+            heap.push({key(r), v.arrival[r], v.pid[r]});
+        }
+
+        if (heap.empty()) { // idle until the next arrival
+            SimTime next = v.arrival[v.byArrival[i]];
+            if (!sink.segment(-1, t, next, false)) return false;
+            t = next; emitted++;
+            sw.idle();
+            continue;
+        }
+
+        int pid = heap.pop().pid;
+        if (SimTime c = sw.charge(pid)) {
+            if (!sink.segment(kSwitchPid, t, t + c, false)) return false;
+            t += c; emitted++;
+        }
+        SimTime burst = v.burst[pid-1];
+        if (!sink.segment(pid, t, t + burst, true)) return false;
+        t += burst; emitted++;
+        finished++;
+    }
+    return true;
+}
+
+// Shortest burst first; ties by arrival, then pid
+template <class Sink, class Hook = NoCheckpoints, class Switch = NoSwitchCost>
+static bool simulateSJF(const ProcessView& v, Sink& sink, Hook hook = Hook(), const EngineCheckpoint* from = nullptr,
+                        Switch sw = Switch(), EngineScratch* scratch = nullptr) {
+    return simulateReadyHeap(v, [&](uint32_t r) { return (long long)v.burst[r]; }, sink, hook, from, sw, scratch);
+}
+
+template <class Sink, class Hook = NoCheckpoints, class Switch = NoSwitchCost>
+static bool simulatePriorityNP(const ProcessView& v, Sink& sink, Hook hook = Hook(), const EngineCheckpoint* from = nullptr,
+                               Switch sw = Switch(), EngineScratch* scratch = nullptr) {
+    // smaller value = higher priority
+    return simulateReadyHeap(v, [&](uint32_t r) { return (long long)v.priority[r]; }, sink, hook, from, sw, scratch);
+}
+
+// Shared core for the preemptive policies. The running process stays outside
+// the heap, so queued keys never change and no decrease-key is needed: the
+// engine only wakes at arrival events, re-keys the running process with
+// key(row, remaining) and preempts it when the heap's best beats it. A
+// process keeps one Segment until it is preempted or finishes. Arrivals
+// during a context switch are admitted when it ends and may preempt the
+// incoming process before it runs at all.
+template <class Key, class Sink, class Switch = NoSwitchCost>
+static bool simulatePreemptiveHeap(const ProcessView& v, Key key, Sink& sink, Switch sw = Switch(),
+                                   EngineScratch* scratch = nullptr) {
+    size_t n = v.n;
+    EngineScratch local;
+    EngineScratch &s = scratch ? *scratch : local;
+    ReadyHeap &heap = s.heap;
+    heap.reset(n);
+    vector<SimTime> &rem = s.rem; // by row
+    rem.assign(v.burst, v.burst + n);
+
+    SimTime t = 0; size_t i = 0; size_t finished = 0;
+    auto admit = [&](SimTime upTo) {
+        while (i < n && v.arrival[v.byArrival[i]] <= upTo) {
+            uint32_t r = v.byArrival[i++];
+            heap.push({key(r, rem[r]), v.arrival[r], v.pid[r]});
+        }
+    };
+
+    while (finished < n) {
+        admit(t);
+        if (heap.empty()) { // idle until the next arrival
+            SimTime next = v.arrival[v.byArrival[i]];
+            if (!sink.segment(-1, t, next, false)) return false;
+            t = next;
+            sw.idle();
+            continue;
+        }
+
+        ReadyEntry cur = heap.pop();
+        int r = cur.pid - 1;
+        if (SimTime c = sw.charge(cur.pid)) {
+            if (!sink.segment(kSwitchPid, t, t + c, false)) return false;
+            t += c;
+            admit(t);
+            if (!heap.empty() && readyBefore(heap.top(), cur)) { heap.push(cur); continue; }
+        }
+        SimTime start = t;
+        while (true) {
+            SimTime done = t + rem[r];
+            if (i < n && v.arrival[v.byArrival[i]] < done) {
+                SimTime next = v.arrival[v.byArrival[i]];
+                rem[r] -= next - t;
+                t = next;
+                admit(t);
+                cur.key = key(r, rem[r]);
+                if (readyBefore(heap.top(), cur)) { // preempted
+                    if (!sink.segment(cur.pid, start, t, false)) return false;
+                    heap.push(cur);
+                    break;
+                }
+            } else {
+                t = done; rem[r] = 0;
+                if (!sink.segment(cur.pid, start, t, true)) return false;
+                finished++;
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+// Shortest remaining time first; ties by arrival, then pid
+template <class Sink, class Switch = NoSwitchCost>
+static bool simulateSRTF(const ProcessView& v, Sink& sink, Switch sw = Switch(), EngineScratch* scratch = nullptr) {
+    return simulatePreemptiveHeap(v, [](uint32_t, SimTime remaining) { return (long long)remaining; }, sink, sw, scratch);
+}
+
+template <class Sink, class Switch = NoSwitchCost>
+static bool simulatePriorityP(const ProcessView& v, Sink& sink, Switch sw = Switch(), EngineScratch* scratch = nullptr) {
+    return simulatePreemptiveHeap(v, [&](uint32_t r, SimTime) { return (long long)v.priority[r]; }, sink, sw, scratch);
+}
+
+// coalesce: when the dispatched process is the only runnable one, keep it on
+// the CPU until it finishes or an arrival lands on one of its slice
+// boundaries, and report that run as a single segment. Metrics are unchanged.
+template <class Sink, class Hook = NoCheckpoints, class Switch = NoSwitchCost>
+static bool simulateRR(const ProcessView& v, int quantum, bool coalesce, Sink& sink,
+                       Hook hook = Hook(), const EngineCheckpoint* from = nullptr, Switch sw = Switch(),
+                       EngineScratch* scratch = nullptr) {
+    if (quantum <= 0) quantum = 1; // safeguard
+    size_t n = v.n;
+    EngineScratch local;
+    EngineScratch &s = scratch ? *scratch : local;
+
+    vector<SimTime> &rem = s.rem;
+    rem.assign(n+1, 0);
+    for (size_t r = 0; r < n; ++r) rem[v.pid[r]] = v.burst[r];
+
+    PidRing &q = s.ring;       // PID queue
+    q.reset(n);
+    vector<bool> &inQueue = s.inQueue;
+    inQueue.assign(n+1, false);
+
+    SimTime time = 0; size_t i = 0; size_t finished = 0; size_t emitted = 0;
+    if (from) {
+        // Every admitted, unfinished process is queued between slices
+        time = from->time; i = from->cursor; finished = from->finished; emitted = from->segments;
+        for (const auto &e : from->queue) { q.push(e.first); inQueue[e.first] = true; rem[e.first] = e.second; }
+        sw.restore(*from);
+    }
+
+    auto enqueue = [&](int pid) {
+        if (inQueue[pid]) return;
+        q.push(pid); inQueue[pid] = true;
+    };
+    auto enqueueArrivals = [&](SimTime upTo) {
+        while (i < n && v.arrival[v.byArrival[i]] <= upTo) {
+            enqueue(v.pid[v.byArrival[i]]); i++;
+        }
+    };
+
+    while (finished < n) {
+        if (hook.due(emitted)) {
+            EngineCheckpoint cp;
+            cp.time = time; cp.cursor = i; cp.finished = finished; cp.segments = emitted;
+            cp.queue.reserve(q.size());
+            for (size_t k = 0; k < q.size(); ++k) cp.queue.push_back({q.at(k), rem[q.at(k)]});
+            sw.save(cp);
+            hook.save(move(cp));
+        }
+        if (q.empty()) {
+            // Jump to next arrival
+            if (i < n) {
+                SimTime next = v.arrival[v.byArrival[i]];
+                if (time < next) {
+                    if (!sink.segment(-1, time, next, false)) return false;
+                    time = next; emitted++;
+                    sw.idle();
+                }
+                enqueueArrivals(time);
+                continue;
+            } else {
+                break; // no more processes (shouldn't happen without finishing all)
+            }
+        }
+
+        int pid = q.pop(); inQueue[pid] = false;
+        if (rem[pid] == 0) continue; // already done (safety)
+        if (SimTime c = sw.charge(pid)) {
+            if (!sink.segment(kSwitchPid, time, time + c, false)) return false;
+            time += c; emitted++;
+        }
+
+        long long exec = min<long long>(quantum, rem[pid]);
+        if (coalesce && q.empty() && exec < rem[pid]) {
+            // Slices keep going back-to-back until one ends at or after the
+            // next arrival, which then queues ahead of this process. (After a
+            // context switch that arrival may already be due: one slice.)
+            long long slices = (i < n)
+                ? max(1LL, ((long long)v.arrival[v.byArrival[i]] - time + quantum - 1) / quantum)
+                : LLONG_MAX / quantum;
+            exec = min<long long>(rem[pid], slices * quantum);
+        }
+        SimTime start = time;
+        time += (SimTime)exec;
+        rem[pid] -= (SimTime)exec;
+        if (!sink.segment(pid, start, time, rem[pid] == 0)) return false;
+        emitted++;
+
+        // Enqueue any new arrivals up to 'time'
+        enqueueArrivals(time);
+
+        if (rem[pid] > 0) {
+            // Put it back to the end of the queue
+            enqueue(pid);
+        } else {
+            finished++;
+        }
+    }
+
+    return true;
+}
+
+// ---- Multilevel feedback queue ----
+// quanta[l] is the slice length at level l (level 0 runs first). A process
+// enters at level 0 and drops one level each time it uses its whole slice;
+// the last level is plain Round Robin. Every `boost` time units (0 = never)
+// all waiting processes go back to level 0 so long jobs cannot starve. As in
+// simulateRR, a slice always runs to its end and arrivals are admitted at
+// slice boundaries; with one level the schedule is exactly runRR's.
+
+static const int kMaxMlfqLevels = 64; // one bit per level in the ready mask
+
+struct MlfqOptions {
+    vector<int> quanta = {2, 4, 8};
+    int boost = 0;
+};
+
+// Levels q, 2q, 4q with a boost every 64q: the configuration the comparison
+// module and batch mode use when no explicit levels are given. Each is
+// clamped to INT_MAX, which a SCHED_TIME64 quantum of 2^25 or more reaches.
+static MlfqOptions defaultMlfq(int quantum) {
+    MlfqOptions o;
+    long long q = max(quantum, 1);
+    auto level = [](long long x) { return (int)min<long long>(x, INT_MAX); };
+    o.quanta = {level(q), level(2 * q), level(4 * q)};
+    o.boost = level(64 * q);
+    return o;
+}
+
+static string mlfqName(const MlfqOptions& o) {
+    string name = "MLFQ (q=";
+    if (o.quanta.size() <= 4) {
+        for (size_t l = 0; l < o.quanta.size(); ++l) name += (l ? "/" : "") + to_string(o.quanta[l]);
+    } else {
+        name += to_string(o.quanta.front()) + ".." + to_string(o.quanta.back())
+              + ", " + to_string(o.quanta.size()) + " levels";
+    }
+    if (o.boost > 0) name += ", boost " + to_string(o.boost);
+    return name + ")";
+}
+
+template <class Sink, class Switch = NoSwitchCost>
+static bool simulateMLFQ(const ProcessView& v, const MlfqOptions& o, Sink& sink, Switch sw = Switch(),
+                         EngineScratch* scratch = nullptr) {
+    size_t n = v.n;
+    EngineScratch local;
+    EngineScratch &s = scratch ? *scratch : local;
+    int levels = (int)min<size_t>(max<size_t>(o.quanta.size(), 1), kMaxMlfqLevels);
+    vector<int> &quanta = s.quanta;
+    quanta.assign(levels, 1);
+    for (int l = 0; l < levels && l < (int)o.quanta.size(); ++l) quanta[l] = max(o.quanta[l], 1);
+
+    vector<SimTime> &rem = s.rem;
+    rem.assign(n+1, 0);
+    for (size_t r = 0; r < n; ++r) rem[v.pid[r]] = v.burst[r];
+
+    // Bit l of ready is set while level l's queue is non-empty, so the next
+    // level to serve is its lowest set bit whatever the number of levels.
+    vector<PidRing> &queue = s.levels;
+    if (queue.size() < (size_t)levels) queue.resize(levels);
+    for (int l = 0; l < levels; ++l) queue[l].reset(16);
+    uint64_t ready = 0;
+    auto push = [&](int level, int pid) {
+        queue[level].push(pid);
+        ready |= uint64_t(1) << level;
+    };
+
+    SimTime time = 0; size_t i = 0; size_t finished = 0;
+    long long nextBoost = o.boost > 0 ? o.boost : LLONG_MAX;
+
+    auto enqueueArrivals = [&](SimTime upTo) {
+        while (i < n && v.arrival[v.byArrival[i]] <= upTo) {
+            push(0, v.pid[v.byArrival[i]]); i++;
+        }
+    };
+    // Lower levels are appended behind level 0 in level order, keeping FIFO
+    // order within each level.
+    auto boostIfDue = [&]() {
+        if (time < nextBoost) return;
+        nextBoost = ((long long)time / o.boost + 1) * o.boost;
+        for (int l = 1; l < levels; ++l)
+            while (!queue[l].empty()) push(0, queue[l].pop());
+        ready &= 1;
+    };
+
+    while (finished < n) {
+        if (ready == 0) {
+            if (i >= n) break; // no more processes (shouldn't happen without finishing all)
+            SimTime next = v.arrival[v.byArrival[i]];
+            if (time < next) {
+                if (!sink.segment(-1, time, next, false)) return false;
+                time = next;
+                sw.idle();
+            }
+            enqueueArrivals(time);
+            boostIfDue();
+            continue;
+        }
+
+        int level = __builtin_ctzll(ready);
+        int pid = queue[level].pop();
+        if (queue[level].empty()) ready &= ~(uint64_t(1) << level);
+        if (SimTime c = sw.charge(pid)) {
+            if (!sink.segment(kSwitchPid, time, time + c, false)) return false;
+            time += c;
+        }
+
+        SimTime exec = min<SimTime>(quanta[level], rem[pid]);
+        SimTime start = time;
+        time += exec;
+        rem[pid] -= exec;
+        if (!sink.segment(pid, start, time, rem[pid] == 0)) return false;
+
+        enqueueArrivals(time);
+
+        if (rem[pid] > 0) push(min(level + 1, levels - 1), pid); // used its whole slice
+        else finished++;
+        boostIfDue();
+    }
+
+    return true;
+}
+
+// ---- Proportional share: lottery and stride ----
+// Both hand out the CPU in slices of `quantum` in proportion to each
+// process's tickets. Tickets come from the priority field and keep its
+// "smaller = higher" sense: a process holds pmax - priority + 1 tickets,
+// where pmax is the largest priority in the set, capped at kMaxTickets (with
+// priorities 1..4, P1 holds four times the tickets of P4). As in simulateRR,
+// a slice always runs to its end and arrivals are admitted at slice
+// boundaries; each slice is its own segment.
+
+static const long long kMaxTickets = 1 << 20;
+static const uint64_t kLotterySeed = 1;
+
+static long long maxPriority(const ProcessView& v) {
+    long long pmax = LLONG_MIN;
+    for (size_t r = 0; r < v.n; ++r) pmax = max<long long>(pmax, v.priority[r]);
+    return pmax;
+}
+
+static long long ticketsOf(long long pmax, int32_t priority) { return min(pmax - priority + 1, kMaxTickets); }
+
+// Lottery: before every slice one ticket is drawn uniformly from those of the
+// ready processes, whose counts sit in a TicketTree, so a draw costs O(log n)
+// however many processes are ready. The schedule is a function of `seed`.
+template <class Sink, class Switch = NoSwitchCost>
+static bool simulateLottery(const ProcessView& v, int quantum, uint64_t seed, Sink& sink, Switch sw = Switch(),
+                            EngineScratch* scratch = nullptr) {
+    if (quantum <= 0) quantum = 1; // safeguard
+    size_t n = v.n;
+    EngineScratch local;
+    EngineScratch &s = scratch ? *scratch : local;
+    vector<SimTime> &rem = s.rem; // by row
+    rem.assign(v.burst, v.burst + n);
+    TicketTree &tickets = s.tickets;
+    tickets.reset(n);
+    long long pmax = maxPriority(v);
+    mt19937_64 rng(seed);
+
+    SimTime time = 0; size_t i = 0; size_t finished = 0;
+    while (finished < n) {
+        while (i < n && v.arrival[v.byArrival[i]] <= time) {
+            uint32_t r = v.byArrival[i++];
+            tickets.add(r, ticketsOf(pmax, v.priority[r]));
+        }
+        if (tickets.total() == 0) { // idle until the next arrival
+            SimTime next = v.arrival[v.byArrival[i]];
+            if (!sink.segment(-1, time, next, false)) return false;
+            time = next;
+            sw.idle();
+            continue;
+        }
+
+        size_t r = tickets.find(uniform_int_distribution<uint64_t>(0, tickets.total() - 1)(rng));
+        if (SimTime c = sw.charge(v.pid[r])) {
+            if (!sink.segment(kSwitchPid, time, time + c, false)) return false;
+            time += c;
+        }
+        SimTime exec = min<SimTime>(quantum, rem[r]);
+        SimTime start = time;
+        time += exec;
+        rem[r] -= exec;
+        if (!sink.segment(v.pid[r], start, time, rem[r] == 0)) return false;
+        if (rem[r] == 0) {
+            tickets.add(r, -ticketsOf(pmax, v.priority[r]));
+            finished++;
+        }
+    }
+    return true;
+}
+
+// Stride: the deterministic counterpart. Each process advances a pass value
+// by kMaxTickets / tickets per slice and the ready process with the lowest
+// pass runs next (ties by arrival, then pid), from the ready heap keyed by
+// pass. An arrival starts one stride past the pass of the latest dispatch,
+// so it neither catches up on time it was not present for nor waits behind
+// processes that have run longer.
+template <class Sink, class Switch = NoSwitchCost>
+static bool simulateStride(const ProcessView& v, int quantum, Sink& sink, Switch sw = Switch(),
+                           EngineScratch* scratch = nullptr) {
+    if (quantum <= 0) quantum = 1; // safeguard
+    size_t n = v.n;
+    EngineScratch local;
+    EngineScratch &s = scratch ? *scratch : local;
+    ReadyHeap &heap = s.heap;
+    heap.reset(n);
+    vector<SimTime> &rem = s.rem; // by row
+    rem.assign(v.burst, v.burst + n);
+    long long pmax = maxPriority(v);
+    auto stride = [&](size_t r) { return kMaxTickets / ticketsOf(pmax, v.priority[r]); };
+
+    SimTime time = 0; size_t i = 0; size_t finished = 0;
+    long long pass = 0; // of the latest dispatch
+    while (finished < n) {
+        while (i < n && v.arrival[v.byArrival[i]] <= time) {
+            uint32_t r = v.byArrival[i++];
+            heap.push({pass + stride(r), v.arrival[r], v.pid[r]});
+        }
+        if (heap.empty()) { // idle until the next arrival
+            SimTime next = v.arrival[v.byArrival[i]];
+            if (!sink.segment(-1, time, next, false)) return false;
+            time = next;
+            sw.idle();
+            continue;
+        }
+
+        ReadyEntry cur = heap.pop();
+        size_t r = cur.pid - 1;
+        pass = cur.key;
+        if (SimTime c = sw.charge(cur.pid)) {
+            if (!sink.segment(kSwitchPid, time, time + c, false)) return false;
+            time += c;
+        }
+        SimTime exec = min<SimTime>(quantum, rem[r]);
+        SimTime start = time;
+        time += exec;
+        rem[r] -= exec;
+        if (!sink.segment(cur.pid, start, time, rem[r] == 0)) return false;
+        if (rem[r] > 0) { cur.key += stride(r); heap.push(cur); }
+        else finished++;
+    }
+    return true;
+}
+
+// Sink selects the output: TimelineSink (default) records the Gantt timeline,
+// CompactTimelineSink records it encoded, MetricsSink computes the same
+// metrics without one.
+// Non-preemptive engines emit each process once plus at most one idle gap
+// before it.
+static size_t nonPreemptiveSegments(const ProcessView& v) { return 2 * v.n; }
+
+// RR emits at most ceil(burst/q) slices per process plus one idle gap each.
+static size_t roundRobinSegments(const ProcessView& v, int quantum) {
+    size_t k = v.n;
+    for (size_t r = 0; r < v.n; ++r) k += (v.burst[r] + quantum - 1) / quantum;
+    return k;
+}
+
+// A switch segment precedes a dispatch at most once per process segment.
+static size_t withSwitches(size_t segments, const DispatchCost& dc) { return dc.none() ? segments : 2 * segments; }
+
+// dc: context-switch cost model; the default (none) runs the engines' plain
+// instantiation.
+template <class Sink = TimelineSink>
+static Result runFCFS(const ProcessView& v, const DispatchCost& dc = DispatchCost()) {
+    InstrumentedRun probe("FCFS");
+    Sink sink(v);
+    sink.expect(withSwitches(nonPreemptiveSegments(v), dc));
+    if (dc.none()) simulateFCFS(v, sink);
+    else simulateFCFS(v, sink, NoCheckpoints(), nullptr, SwitchCost{dc});
+    return sink.result("FCFS", v);
+}
+
+template <class Sink = TimelineSink>
+static Result runSJF(const ProcessView& v, const DispatchCost& dc = DispatchCost()) {
+    InstrumentedRun probe("SJF (Non-Preemptive)");
+    Sink sink(v);
+    sink.expect(withSwitches(nonPreemptiveSegments(v), dc));
+    if (dc.none()) simulateSJF(v, sink);
+    else simulateSJF(v, sink, NoCheckpoints(), nullptr, SwitchCost{dc});
+    return sink.result("SJF (Non-Preemptive)", v);
+}
+
+template <class Sink = TimelineSink>
+static Result runPriorityNP(const ProcessView& v, const DispatchCost& dc = DispatchCost()) {
+    InstrumentedRun probe("Priority (Non-Preemptive)");
+    Sink sink(v);
+    sink.expect(withSwitches(nonPreemptiveSegments(v), dc));
+    if (dc.none()) simulatePriorityNP(v, sink);
+    else simulatePriorityNP(v, sink, NoCheckpoints(), nullptr, SwitchCost{dc});
+    return sink.result("Priority (Non-Preemptive)", v);
+}
+
+// A process is preempted at most once per arrival, so the preemptive engines
+// emit at most n segments plus one per arrival and one idle gap each.
+static size_t preemptiveSegments(const ProcessView& v) { return 3 * v.n; }
+
+template <class Sink = TimelineSink>
+static Result runSRTF(const ProcessView& v, const DispatchCost& dc = DispatchCost()) {
+    InstrumentedRun probe("SRTF (Preemptive SJF)");
+    Sink sink(v);
+    sink.expect(withSwitches(preemptiveSegments(v), dc));
+    if (dc.none()) simulateSRTF(v, sink);
+    else simulateSRTF(v, sink, SwitchCost{dc});
+    return sink.result("SRTF (Preemptive SJF)", v);
+}
+
+template <class Sink = TimelineSink>
+static Result runPriorityP(const ProcessView& v, const DispatchCost& dc = DispatchCost()) {
+    InstrumentedRun probe("Priority (Preemptive)");
+    Sink sink(v);
+    sink.expect(withSwitches(preemptiveSegments(v), dc));
+    if (dc.none()) simulatePriorityP(v, sink);
+    else simulatePriorityP(v, sink, SwitchCost{dc});
+    return sink.result("Priority (Preemptive)", v);
+}
+
+template <class Sink = TimelineSink>
+static Result runRR(const ProcessView& v, int quantum, bool coalesce = false, const DispatchCost& dc = DispatchCost()) {
+    if (quantum <= 0) quantum = 1; // safeguard
+    string name = "Round Robin (q=" + to_string(quantum) + ")";
+    InstrumentedRun probe(name);
+    Sink sink(v);
+    sink.expect(withSwitches(roundRobinSegments(v, quantum), dc));
+    if (dc.none()) simulateRR(v, quantum, coalesce, sink);
+    else simulateRR(v, quantum, coalesce, sink, NoCheckpoints(), nullptr, SwitchCost{dc});
+    return sink.result(name, v);
+}
+
+template <class Sink = TimelineSink>
+static Result runLottery(const ProcessView& v, int quantum, uint64_t seed = kLotterySeed,
+                         const DispatchCost& dc = DispatchCost()) {
+    if (quantum <= 0) quantum = 1; // safeguard
+    string name = "Lottery (q=" + to_string(quantum) + ")";
+    InstrumentedRun probe(name);
+    Sink sink(v);
+    sink.expect(withSwitches(roundRobinSegments(v, quantum), dc));
+    if (dc.none()) simulateLottery(v, quantum, seed, sink);
+    else simulateLottery(v, quantum, seed, sink, SwitchCost{dc});
+    return sink.result(name, v);
+}
+
+template <class Sink = TimelineSink>
+static Result runStride(const ProcessView& v, int quantum, const DispatchCost& dc = DispatchCost()) {
+    if (quantum <= 0) quantum = 1; // safeguard
+    string name = "Stride (q=" + to_string(quantum) + ")";
+    InstrumentedRun probe(name);
+    Sink sink(v);
+    sink.expect(withSwitches(roundRobinSegments(v, quantum), dc));
+    if (dc.none()) simulateStride(v, quantum, sink);
+    else simulateStride(v, quantum, sink, SwitchCost{dc});
+    return sink.result(name, v);
+}
+
+template <class Sink = TimelineSink>
+static Result runMLFQ(const ProcessView& v, const MlfqOptions& o, const DispatchCost& dc = DispatchCost()) {
+    string name = mlfqName(o);
+    InstrumentedRun probe(name);
+    Sink sink(v);
+    int shortest = o.quanta.empty() ? 1 : max(1, *min_element(o.quanta.begin(), o.quanta.end()));
+    sink.expect(withSwitches(roundRobinSegments(v, shortest), dc));
+    if (dc.none()) simulateMLFQ(v, o, sink);
+    else simulateMLFQ(v, o, sink, SwitchCost{dc});
+    return sink.result(name, v);
+}
+
+// ---------- Reusable run context ----------
+// For callers that run many simulations back to back (benchmarks, parameter
+// studies, tools embedding the engines): a SimulationContext owns the
+// engines' scratch storage and one Result whose vectors, histograms and
+// timeline keep their capacity from run to run. Once it has run a set of a
+// given size, or after reserve(), a run performs no heap allocation. Each
+// run* returns the context's Result, valid until the next run on the same
+// context; a context is used by one thread at a time.
+
+class SimulationContext {
+public:
+    // timeline = false: metrics only, as with MetricsSink
+    explicit SimulationContext(bool timeline = true) : timeline_(timeline) {}
+
+    // Sizes the buffers for sets of up to n processes and timelines of up to
+    // `segments` segments, so even the first run allocates nothing (MLFQ
+    // level queues excepted: they grow to their working size on first use).
+    void reserve(size_t n, size_t segments) {
+        scratch_.heap.reset(n); scratch_.ring.reset(n);
+        scratch_.rem.reserve(n+1); scratch_.inQueue.reserve(n+1); scratch_.tickets.tree.reserve(n+1);
+        if (timeline_) r_.timeline.reserve(segments);
+        for (auto *col : {&r_.completion, &r_.waiting, &r_.tat, &r_.response}) col->reserve(n+1);
+        r_.stats.reserve();
+        r_.algo_name.reserve(64);
+    }
+
+    const Result& runFCFS(const ProcessView& v, const DispatchCost& dc = DispatchCost()) {
+        r_.algo_name.assign("FCFS");
+        return run(v, nonPreemptiveSegments(v), dc, [&](Sink& sink, auto sw) {
+            simulateFCFS(v, sink, NoCheckpoints(), nullptr, sw);
+        });
+    }
+    const Result& runSJF(const ProcessView& v, const DispatchCost& dc = DispatchCost()) {
+        r_.algo_name.assign("SJF (Non-Preemptive)");
+        return run(v, nonPreemptiveSegments(v), dc, [&](Sink& sink, auto sw) {
+            simulateSJF(v, sink, NoCheckpoints(), nullptr, sw, &scratch_);
+        });
+    }
+    const Result& runPriorityNP(const ProcessView& v, const DispatchCost& dc = DispatchCost()) {
+        r_.algo_name.assign("Priority (Non-Preemptive)");
+        return run(v, nonPreemptiveSegments(v), dc, [&](Sink& sink, auto sw) {
+            simulatePriorityNP(v, sink, NoCheckpoints(), nullptr, sw, &scratch_);
+        });
+    }
+    const Result& runSRTF(const ProcessView& v, const DispatchCost& dc = DispatchCost()) {
+        r_.algo_name.assign("SRTF (Preemptive SJF)");
+        return run(v, preemptiveSegments(v), dc, [&](Sink& sink, auto sw) {
+            simulateSRTF(v, sink, sw, &scratch_);
+        });
+    }
+    const Result& runPriorityP(const ProcessView& v, const DispatchCost& dc = DispatchCost()) {
+        r_.algo_name.assign("Priority (Preemptive)");
+        return run(v, preemptiveSegments(v), dc, [&](Sink& sink, auto sw) {
+            simulatePriorityP(v, sink, sw, &scratch_);
+        });
+    }
+    const Result& runRR(const ProcessView& v, int quantum, bool coalesce = false, const DispatchCost& dc = DispatchCost()) {
+        if (quantum <= 0) quantum = 1; // safeguard
+        r_.algo_name.assign("Round Robin (q=").append(to_string(quantum)).append(")");
+        return run(v, roundRobinSegments(v, quantum), dc, [&](Sink& sink, auto sw) {
+            simulateRR(v, quantum, coalesce, sink, NoCheckpoints(), nullptr, sw, &scratch_);
+        });
+    }
+    const Result& runLottery(const ProcessView& v, int quantum, uint64_t seed = kLotterySeed,
+                             const DispatchCost& dc = DispatchCost()) {
+        if (quantum <= 0) quantum = 1; // safeguard
+        r_.algo_name.assign("Lottery (q=").append(to_string(quantum)).append(")");
+        return run(v, roundRobinSegments(v, quantum), dc, [&](Sink& sink, auto sw) {
+            simulateLottery(v, quantum, seed, sink, sw, &scratch_);
+        });
+    }
+    const Result& runStride(const ProcessView& v, int quantum, const DispatchCost& dc = DispatchCost()) {
+        if (quantum <= 0) quantum = 1; // safeguard
+        r_.algo_name.assign("Stride (q=").append(to_string(quantum)).append(")");
+        return run(v, roundRobinSegments(v, quantum), dc, [&](Sink& sink, auto sw) {
+            simulateStride(v, quantum, sink, sw, &scratch_);
+        });
+    }
+    const Result& runMLFQ(const ProcessView& v, const MlfqOptions& o, const DispatchCost& dc = DispatchCost()) {
+        // The name is rebuilt only when the options change
+        if (mlfqName_.empty() || o.quanta != mlfq_.quanta || o.boost != mlfq_.boost) { mlfq_ = o; mlfqName_ = mlfqName(o); }
+        r_.algo_name.assign(mlfqName_);
+        int shortest = o.quanta.empty() ? 1 : max(1, *min_element(o.quanta.begin(), o.quanta.end()));
+        return run(v, roundRobinSegments(v, shortest), dc, [&](Sink& sink, auto sw) {
+            simulateMLFQ(v, o, sink, sw, &scratch_);
+        });
+    }
+
+private:
+    // Appends to the context's timeline, or records first dispatch and
+    // completion times as MetricsSink does.
+    struct Sink {
+        SimulationContext &c;
+
+        bool segment(int pid, SimTime start, SimTime end, bool finished) {
+            countSegment(pid);
+            Result &r = c.r_;
+            if (c.timeline_) { r.timeline.push_back({pid, start, end}); return true; }
+            if (pid < 0) {
+                if (pid == kSwitchPid) { r.switch_count++; r.switch_time += end - start; }
+                return true;
+            }
+            r.response[pid] = min(r.response[pid], start);
+            if (finished) r.completion[pid] = end;
+            return true;
+        }
+    };
+
+    template <class Simulate>
+    const Result& run(const ProcessView& v, size_t segments, const DispatchCost& dc, Simulate simulate) {
+        InstrumentedRun probe(r_.algo_name);
+        Sink sink{*this};
+        r_.timeline.clear();
+        if (timeline_) {
+            r_.timeline.reserve(withSwitches(segments, dc));
+        } else {
+            r_.completion.assign(v.n+1, 0);
+            r_.response.assign(v.n+1, kTimeMax);
+            r_.switch_count = 0; r_.switch_time = 0;
+        }
+        if (dc.none()) simulate(sink, NoSwitchCost());
+        else simulate(sink, SwitchCost{dc});
+
+        PhaseTimer timer(Phase::Metrics);
+        if (timeline_) {
+            metricsFromTimeline(r_, v);
+        } else {
+            r_.avg_wait = r_.avg_tat = 0.0;
+            r_.stats.clear();
+            computeMetrics(r_, v);
+        }
+        return r_;
+    }
+
+    bool timeline_;
+    EngineScratch scratch_;
+    Result r_;
+    MlfqOptions mlfq_;   // options behind mlfqName_
+    string mlfqName_;
+};
+
+// ---------- Incremental re-simulation ----------
+// The menu keeps one IncrementalRun per engine. Each run records about
+// kReplayCheckpoints checkpoints and keeps its timeline. After edits to
+// processes that arrive no earlier than T (invalidate(T)), the next run
+// resumes from the last checkpoint taken before T, copies the timeline up to
+// it and simulates only the rest, so the timeline and every metric match a
+// full rerun.
+
+enum class ReplayEngine { FCFS, SJF, PriorityNP, RoundRobin };
+
+static const size_t kReplayCheckpoints = 64;
+
+class IncrementalRun {
+public:
+    explicit IncrementalRun(ReplayEngine e, int quantum = 1, bool coalesce = false, DispatchCost dc = DispatchCost())
+        : engine_(e), quantum_(max(quantum, 1)), coalesce_(coalesce), dc_(dc) {}
+
+    ReplayEngine engine() const { return engine_; }
+    int quantum() const { return quantum_; }
+    bool coalesce() const { return coalesce_; }
+    const DispatchCost& dispatchCost() const { return dc_; }
+
+    // Only processes arriving at or after `since` (before and after the
+    // edit) changed since the last run.
+    void invalidate(SimTime since) { dirty_ = min(dirty_, since); }
+    // The whole set was replaced; the next run starts from scratch.
+    void reset() { checkpoints_.clear(); timeline_.clear(); dirty_ = kTimeMax; }
+
+    // Segments copied from the previous run by the last run() call
+    size_t reused() const { return reused_; }
+    SimTime resumedAt() const { return resumedAt_; }
+
+    Result run(const ProcessView& v) {
+        if (!timeline_.empty() && v.n != n_) reset();
+        // Keep the checkpoints strictly before the first edited arrival and
+        // resume from the last of them; later ones are re-recorded.
+        size_t keep = 0;
+        while (keep < checkpoints_.size() && checkpoints_[keep].time < dirty_) ++keep;
+        EngineCheckpoint from;
+        if (keep) from = checkpoints_[keep-1];
+        checkpoints_.resize(keep);
+
+        size_t bound = withSwitches(engine_ == ReplayEngine::RoundRobin ? roundRobinSegments(v, quantum_)
+                                                                        : nonPreemptiveSegments(v), dc_);
+        size_t every = max<size_t>(1, bound / kReplayCheckpoints);
+        CheckpointRecorder rec{&checkpoints_, every, from.segments + every};
+        const EngineCheckpoint *start = keep ? &from : nullptr;
+
+        TimelineSink sink(v);
+        sink.expect(bound);
+        sink.tl.insert(sink.tl.end(), timeline_.begin(), timeline_.begin() + from.segments);
+        string name;
+        auto simulate = [&](auto sw) {
+            switch (engine_) {
+                case ReplayEngine::FCFS:
+                    simulateFCFS(v, sink, rec, start, sw); name = "FCFS"; break;
+                case ReplayEngine::SJF:
+                    simulateSJF(v, sink, rec, start, sw); name = "SJF (Non-Preemptive)"; break;
+                case ReplayEngine::PriorityNP:
+                    simulatePriorityNP(v, sink, rec, start, sw); name = "Priority (Non-Preemptive)"; break;
+                case ReplayEngine::RoundRobin:
+                    simulateRR(v, quantum_, coalesce_, sink, rec, start, sw);
+                    name = "Round Robin (q=" + to_string(quantum_) + ")"; break;
+            }
+        };
+        if (dc_.none()) simulate(NoSwitchCost());
+        else simulate(SwitchCost{dc_});
+
+        reused_ = from.segments; resumedAt_ = from.time;
+        timeline_ = sink.tl;
+        n_ = v.n; dirty_ = kTimeMax;
+        return sink.result(name, v);
+    }
+
+private:
+    ReplayEngine engine_;
+    int quantum_;
+    bool coalesce_;
+    DispatchCost dc_;
+    size_t n_ = 0;
+    SimTime dirty_ = kTimeMax;
+    vector<EngineCheckpoint> checkpoints_;
+    vector<Segment> timeline_;
+    size_t reused_ = 0;
+    SimTime resumedAt_ = 0;
+};
+
+// ---------- Online scheduler ----------
+// Live counterpart of the engines for arrival feeds that never end: callers
+// submit() processes in arrival order, advanceTo(t) promises that nothing
+// earlier than t will follow, and drainSegments() hands over the segments
+// decided so far. The scheduler uses the same ready structures and
+// tie-breaking as the batch cores (FIFO ring for FCFS/RR, key heap for the
+// rest) and only commits a decision once no unseen arrival could change it,
+// so a fed-and-closed stream yields exactly the batch timeline.
+// Memory is bounded by the active processes: a process's slot is recycled
+// and its metrics go into RunStats when it finishes, and drained segments
+// are forgotten.
+
+enum class OnlinePolicy { FCFS, SJF, PriorityNP, RoundRobin, SRTF, PriorityP };
+
+// Heap entry: seq is the submission order, which for a feed sorted by
+// (arrival, pid) is the batch engines' (arrival, pid) tie-break.
+struct OnlineEntry {
+    long long key;
+    uint64_t seq;
+    uint32_t slot;
+};
+
+static bool readyBefore(const OnlineEntry& x, const OnlineEntry& y) {
+    if (x.key != y.key) return x.key < y.key;
+    return x.seq < y.seq;
+}
+
+class OnlineScheduler {
+public:
+    explicit OnlineScheduler(OnlinePolicy p, int quantum = 1)
+        : policy_(p), quantum_(max(quantum, 1)), pending_(1024), ring_(1024), heap_(1024) {}
+
+    OnlinePolicy policy() const { return policy_; }
+    string name() const {
+        switch (policy_) {
+            case OnlinePolicy::FCFS:       return "FCFS";
+            case OnlinePolicy::SJF:        return "SJF (Non-Preemptive)";
+            case OnlinePolicy::PriorityNP: return "Priority (Non-Preemptive)";
+            case OnlinePolicy::RoundRobin: return "Round Robin (q=" + to_string(quantum_) + ")";
+            case OnlinePolicy::SRTF:       return "SRTF (Preemptive SJF)";
+            case OnlinePolicy::PriorityP:  return "Priority (Preemptive)";
+        }
+        return "";
+    }
+
+    // Arrivals must be non-decreasing and no earlier than the last advanceTo(),
+    // and the stream as a whole must fit its TimeBudget.
+    void submit(const Process& p) {
+        if (closed_) throw runtime_error("submit after close()");
+        if (p.arrival < watermark_)
+            throw runtime_error("PID " + to_string(p.pid) + ": arrival " + to_string(p.arrival) +
+                                " is before the stream time " + to_string(watermark_));
+        if (p.burst <= 0) throw runtime_error("PID " + to_string(p.pid) + ": burst must be positive");
+        TimeBudget budget = budget_;
+        budget.add(p.arrival, p.burst);
+        if (!budget.fits()) throw runtime_error("PID " + to_string(p.pid) + ": " + budget.error());
+        budget_ = budget;
+        uint32_t s;
+        if (!free_.empty()) { s = free_.back(); free_.pop_back(); }
+        else { s = (uint32_t)jobs_.size(); jobs_.emplace_back(); }
+        jobs_[s] = {p.pid, p.arrival, p.burst, p.priority, p.burst, -1, seq_++};
+        pending_.push((int)s);
+        watermark_ = p.arrival;
+        active_++; peak_ = max(peak_, active_);
+        pump();
+    }
+    // No arrival before t will be submitted.
+    void advanceTo(SimTime t) {
+        if (t > watermark_) { watermark_ = t; pump(); }
+    }
+    // End of the feed: everything still queued runs to completion.
+    void close() { closed_ = true; pump(); }
+
+    // Appends the segments decided since the last call.
+    void drainSegments(vector<Segment>& out) {
+        out.insert(out.end(), out_.begin(), out_.end());
+        out_.clear();
+    }
+
+    SimTime now() const { return now_; }
+    size_t active() const { return active_; }      // submitted, not finished
+    size_t peakActive() const { return peak_; }
+    size_t completed() const { return completed_; }
+    double avgWait() const { return completed_ ? (double)sumWait_ / completed_ : 0.0; }
+    double avgTat() const { return completed_ ? (double)sumTat_ / completed_ : 0.0; }
+    const RunStats& stats() const { return stats_; }
+
+private:
+    struct Job {
+        int pid;
+        SimTime arrival, burst;
+        int priority;
+        SimTime rem;
+        SimTime first;  // first dispatch, -1 until then
+        uint64_t seq;
+    };
+
+    bool ring() const { return policy_ == OnlinePolicy::FCFS || policy_ == OnlinePolicy::RoundRobin; }
+    bool preemptive() const { return policy_ == OnlinePolicy::SRTF || policy_ == OnlinePolicy::PriorityP; }
+    // Every arrival at or before x has been submitted
+    bool decidable(SimTime x) const { return closed_ || x < watermark_; }
+
+    long long key(const Job& j) const {
+        switch (policy_) {
+            case OnlinePolicy::SJF:  return j.burst;
+            case OnlinePolicy::SRTF: return j.rem;
+            case OnlinePolicy::PriorityNP:
+            case OnlinePolicy::PriorityP: return j.priority;
+            default: return 0;
+        }
+    }
+    OnlineEntry entry(uint32_t s) const { return {key(jobs_[s]), jobs_[s].seq, s}; }
+
+    void admit(SimTime upTo) {
+        while (!pending_.empty() && jobs_[pending_.at(0)].arrival <= upTo) {
+            uint32_t s = (uint32_t)pending_.pop();
+            if (ring()) ring_.push((int)s); else heap_.push(entry(s));
+        }
+    }
+    // Idle until the next known arrival; false if there is none yet.
+    bool idle() {
+        if (pending_.empty()) return false;
+        SimTime next = jobs_[pending_.at(0)].arrival;
+        if (now_ < next) { emit(-1, now_, next); now_ = next; }
+        return true;
+    }
+    void emit(int pid, SimTime start, SimTime end) { out_.push_back({pid, start, end}); }
+    void dispatch(uint32_t s) { if (jobs_[s].first < 0) jobs_[s].first = now_; }
+
+    void retire(uint32_t s, SimTime end) {
+        const Job &j = jobs_[s];
+        SimTime tat = end - j.arrival, wait = tat - j.burst;
+        sumWait_ += wait; sumTat_ += tat;
+        stats_.wait.record(wait);
+        stats_.tat.record(tat);
+        stats_.response.record(j.first - j.arrival);
+        double slow = (double)tat / j.burst;
+        stats_.slowdownSum += slow; stats_.slowdownSq += slow * slow;
+        free_.push_back(s);
+        active_--; completed_++;
+    }
+
+    // Runs the schedule forward as far as the submitted arrivals allow.
+    void pump() {
+        if (ring()) pumpRing();
+        else if (preemptive()) pumpPreemptive();
+        else pumpHeap();
+    }
+
+    // FCFS/RR: the ring's front is fixed once queued (later arrivals go
+    // behind it), but a slice that does not finish is re-queued only once
+    // every arrival up to its end is known, as simulateRR queues those first.
+    void pumpRing() {
+        SimTime slice = policy_ == OnlinePolicy::FCFS ? kTimeMax : quantum_;
+        while (true) {
+            if (running_) {
+                if (!decidable(sliceEnd_)) return;
+                now_ = sliceEnd_; running_ = false;
+                admit(now_);
+                ring_.push((int)cur_.slot);
+            }
+            admit(now_);
+            if (ring_.empty()) { if (!idle()) return; continue; }
+            uint32_t s = (uint32_t)ring_.pop();
+            Job &j = jobs_[s];
+            dispatch(s);
+            SimTime exec = min(slice, j.rem);
+            emit(j.pid, now_, now_ + exec);
+            j.rem -= exec;
+            if (j.rem > 0) { running_ = true; cur_.slot = s; sliceEnd_ = now_ + exec; }
+            else { now_ += exec; retire(s, now_); }
+        }
+    }
+
+    // SJF/Priority: picking from the heap needs every arrival up to now.
+    void pumpHeap() {
+        while (true) {
+            admit(now_);
+            if (!decidable(now_)) return;
+            if (heap_.empty()) { if (!idle()) return; continue; }
+            uint32_t s = heap_.pop().slot;
+            Job &j = jobs_[s];
+            dispatch(s);
+            emit(j.pid, now_, now_ + j.rem);
+            now_ += j.rem; j.rem = 0;
+            retire(s, now_);
+        }
+    }
+
+    // SRTF/preemptive Priority, as simulatePreemptiveHeap: the running job
+    // is re-keyed at each arrival before it finishes and preempted when the
+    // heap's best beats it.
+    void pumpPreemptive() {
+        while (true) {
+            if (running_) {
+                Job &j = jobs_[cur_.slot];
+                SimTime done = now_ + j.rem;
+                if (!pending_.empty() && jobs_[pending_.at(0)].arrival < done) {
+                    SimTime next = jobs_[pending_.at(0)].arrival;
+                    if (!decidable(next)) return;
+                    j.rem -= next - now_; now_ = next;
+                    admit(now_);
+                    cur_.key = key(j);
+                    if (readyBefore(heap_.top(), cur_)) {
+                        emit(j.pid, start_, now_);
+                        heap_.push(cur_); running_ = false;
+                    }
+                    continue;
+                }
+                if (!closed_ && done > watermark_) return; // an arrival may still preempt it
+                now_ = done; j.rem = 0; running_ = false;
+                emit(j.pid, start_, now_);
+                retire(cur_.slot, now_);
+                continue;
+            }
+            admit(now_);
+            if (!decidable(now_)) return;
+            if (heap_.empty()) { if (!idle()) return; continue; }
+            cur_ = heap_.pop(); running_ = true; start_ = now_;
+            dispatch(cur_.slot);
+        }
+    }
+
+    OnlinePolicy policy_;
+    int quantum_;
+    vector<Job> jobs_;            // slots; finished ones are on free_
+    vector<uint32_t> free_;
+    PidRing pending_;             // submitted slots not yet admitted, by arrival
+    PidRing ring_;                // FCFS/RR ready queue
+    BasicReadyHeap<OnlineEntry> heap_;
+    vector<Segment> out_;         // decided, not yet drained
+
+    SimTime now_ = 0, watermark_ = 0;
+    TimeBudget budget_;           // everything submitted so far
+    bool closed_ = false;
+    uint64_t seq_ = 0;
+    bool running_ = false;
+    OnlineEntry cur_{0, 0, 0};
+    SimTime start_ = 0, sliceEnd_ = 0;
+
+    size_t active_ = 0, peak_ = 0, completed_ = 0;
+    TimeSum sumWait_ = 0, sumTat_ = 0;
+    RunStats stats_;
+};
+
+// ---------- Multi-CPU (SMP) engine ----------
+// M CPUs with one run queue each (RR ring or SJF/Priority heap). Arriving
+// processes are placed on a queue -- statically by PID, or on the least
+// loaded CPU -- and a CPU only ever runs work from its own queue unless work
+// stealing is on, in which case an idle CPU takes from the busiest queue.
+// The engine is event driven: a heap of per-CPU "slice ends at t" events plus
+// the arrival cursor, so cost is O(dispatches * log M) plus O(M) scans only
+// when placing least-loaded or stealing. Arrivals are handled
+// before CPU events at the same instant, as in runRR. With one CPU the
+// schedules equal runRR / runSJF / runPriorityNP.
+
+enum class SmpPolicy { RoundRobin, SJF, Priority };
+
+static const int kMaxCpus = 4096; // batch --cpus and grid units
+
+struct SmpOptions {
+    int cpus = 4;
+    SmpPolicy policy = SmpPolicy::RoundRobin;
+    int quantum = 4;          // RoundRobin only
+    bool steal = false;       // idle CPUs take work from the busiest queue
+    bool leastLoaded = false; // place arrivals on the least loaded CPU (else by PID, round robin)
+    bool timeline = true;     // record per-CPU timelines (off: metrics only)
+};
+
+struct CpuStats {
+    long long busy = 0;
+    size_t dispatches = 0;
+    size_t steals = 0;        // processes this CPU took from another queue
+    size_t segments = 0;
+};
+
+struct SmpResult {
+    Result metrics;                    // per-PID metrics and averages (no timeline)
+    vector<vector<Segment>> timelines; // per CPU, IDLE gaps included
+    vector<CpuStats> cpu;
+    SimTime makespan = 0;              // last completion
+    double imbalance = 0.0;            // max busy / mean busy (1 = balanced)
+    size_t migrations = 0;             // dispatches on a different CPU than last time
+};
+
+static string smpPolicyName(const SmpOptions& o) {
+    string name = o.policy == SmpPolicy::RoundRobin ? "Round Robin (q=" + to_string(o.quantum) + ")"
+                : o.policy == SmpPolicy::SJF ? string("SJF (Non-Preemptive)") : string("Priority (Non-Preemptive)");
+    return name + " x" + to_string(o.cpus) + " CPUs" + (o.steal ? ", stealing" : "");
+}
+
+static SmpResult runSMP(const ProcessView& v, const SmpOptions& opt) {
+    int m = max(1, opt.cpus);
+    int quantum = max(1, opt.quantum);
+    size_t n = v.n;
+    bool rr = opt.policy == SmpPolicy::RoundRobin;
+    auto keyOf = [&](uint32_t r) {
+        return (long long)(opt.policy == SmpPolicy::SJF ? v.burst[r] : v.priority[r]);
+    };
+
+    struct Cpu {
+        PidRing ring{16};      // RoundRobin queue
+        ReadyHeap heap{0};     // SJF / Priority queue
+        int running = -1;      // PID on the CPU, -1 when idle
+        SimTime sliceStart = 0;
+        SimTime idleSince = 0;
+        size_t queued() const { return ring.size() + heap.size(); }
+    };
+    vector<Cpu> cpus(m);
+
+    SmpResult res;
+    res.cpu.assign(m, CpuStats());
+    if (opt.timeline) res.timelines.assign(m, vector<Segment>());
+    Result &r = res.metrics;
+    r.algo_name = smpPolicyName(opt);
+    InstrumentedRun probe(r.algo_name);
+    r.completion.assign(n+1, 0);
+    r.response.assign(n+1, kTimeMax);
+
+    vector<SimTime> rem(n+1, 0);
+    vector<int> lastCpu(n+1, -1);
+    for (size_t k = 0; k < n; ++k) rem[v.pid[k]] = v.burst[k];
+
+    // (time, cpu) of each busy CPU's next slice end; earliest first, ties by CPU
+    using Event = pair<SimTime, int>;
+    priority_queue<Event, vector<Event>, greater<Event>> events;
+
+    size_t queuedTotal = 0;
+    vector<int> touched; // idle CPUs that received arrivals in the current batch
+    auto enqueue = [&](int c, int pid) {
+        if (rr) cpus[c].ring.push(pid);
+        else    cpus[c].heap.push({keyOf(pid-1), v.arrival[pid-1], pid});
+        queuedTotal++;
+    };
+    auto take = [&](int c, bool fromBack) {
+        queuedTotal--;
+        if (!rr) return cpus[c].heap.pop().pid;
+        return fromBack ? cpus[c].ring.popBack() : cpus[c].ring.pop();
+    };
+    auto place = [&](uint32_t row) {
+        int c = (int)(row % m);
+        if (opt.leastLoaded) {
+            // Scan from the static slot so ties spread over the CPUs
+            size_t best = SIZE_MAX; int at = c;
+            for (int k = 0; k < m; ++k, at = (at + 1 == m ? 0 : at + 1)) {
+                size_t load = cpus[at].queued() + (cpus[at].running >= 0);
+                if (load < best) { best = load; c = at; if (load == 0) break; }
+            }
+        }
+        enqueue(c, v.pid[row]);
+        if (cpus[c].running < 0) touched.push_back(c);
+    };
+    // CPU c is free at time t: run the next process from its queue, or steal
+    int idleCount = m;
+    auto dispatch = [&](int c, SimTime t) {
+        Cpu &cpu = cpus[c];
+        int pid = -1;
+        if (cpu.queued() > 0) {
+            pid = take(c, false);
+        } else if (opt.steal && queuedTotal > 0) {
+            int victim = -1; size_t most = 0;
+            for (int k = 0; k < m; ++k)
+                if (cpus[k].queued() > most) { most = cpus[k].queued(); victim = k; }
+            pid = take(victim, true);
+            res.cpu[c].steals++;
+        }
+        if (pid < 0) {
+            if (cpu.running >= 0) { cpu.running = -1; cpu.idleSince = t; idleCount++; }
+            return;
+        }
+        if (cpu.running < 0) {
+            idleCount--;
+            if (t > cpu.idleSince) {
+                SCHED_COUNT(cnt->idleGaps++; cnt->segments++);
+                if (opt.timeline) res.timelines[c].push_back({-1, cpu.idleSince, t});
+            }
+        } else if (cpu.running != pid) {
+            SCHED_COUNT(cnt->switches++);
+        }
+        SCHED_COUNT(cnt->dispatches++);
+        if (lastCpu[pid] >= 0 && lastCpu[pid] != c) res.migrations++;
+        lastCpu[pid] = c;
+        cpu.running = pid; cpu.sliceStart = t;
+        r.response[pid] = min(r.response[pid], t);
+        res.cpu[c].dispatches++;
+        events.push({t + (rr ? min<SimTime>(quantum, rem[pid]) : rem[pid]), c});
+    };
+
+    size_t i = 0, finished = 0;
+    while (finished < n) {
+        // Arrivals first: they precede CPU events at the same instant
+        if (i < n && (events.empty() || v.arrival[v.byArrival[i]] <= events.top().first)) {
+            SimTime t = v.arrival[v.byArrival[i]];
+            touched.clear();
+            while (i < n && v.arrival[v.byArrival[i]] == t) place(v.byArrival[i++]);
+            // Idle CPUs start on their own new work before anyone steals
+            for (int c : touched)
+                if (cpus[c].running < 0) dispatch(c, t);
+            if (opt.steal)
+                for (int c = 0; c < m && idleCount > 0 && queuedTotal > 0; ++c)
+                    if (cpus[c].running < 0) dispatch(c, t);
+            continue;
+        }
+
+        Event e = events.top(); events.pop();
+        SimTime t = e.first;
+        int c = e.second;
+        Cpu &cpu = cpus[c];
+        int pid = cpu.running;
+        SimTime ran = t - cpu.sliceStart;
+        rem[pid] -= ran;
+        res.cpu[c].busy += ran;
+        res.cpu[c].segments++;
+        SCHED_COUNT(cnt->segments++);
+        if (opt.timeline) res.timelines[c].push_back({pid, cpu.sliceStart, t});
+
+        if (rem[pid] == 0) {
+            finished++;
+            r.completion[pid] = t;
+            res.makespan = max(res.makespan, t);
+        } else {
+            enqueue(c, pid); // quantum expired: back of its own queue
+        }
+        // cpu.running still holds pid, so an empty queue marks the CPU idle here
+        dispatch(c, t);
+    }
+
+    {
+        PhaseTimer timer(Phase::Metrics);
+        computeMetrics(r, v);
+    }
+    long long total = 0, most = 0;
+    for (const auto &cs : res.cpu) { total += cs.busy; most = max(most, cs.busy); }
+    res.imbalance = total > 0 ? (double)most * m / total : 1.0;
+    return res;
+}
+
+static void printSmpResult(const SmpResult &res, const ProcessView& v, bool fullTable = false) {
+    PhaseTimer timer(Phase::Print);
+    const Result &r = res.metrics;
+    cout << "\n=== " << r.algo_name << " Result ===\n";
+
+    const size_t kMaxCharts = 16;
+    for (size_t c = 0; c < res.timelines.size() && c < kMaxCharts; ++c) {
+        cout << "\nCPU " << c << ":";
+        drawGantt(res.timelines[c]);
+    }
+    if (res.timelines.size() > kMaxCharts)
+        cout << "\n[Info] Gantt charts shown for the first " << kMaxCharts << " CPUs only.\n";
+
+    cout << "\nPer-CPU Utilization:\n";
+    cout << left << setw(6) << "CPU" << right << setw(12) << "Busy" << setw(12) << "Util %"
+         << setw(12) << "Dispatches" << setw(10) << "Steals" << "\n";
+    cout << string(52, '-') << "\n";
+    for (size_t c = 0; c < res.cpu.size(); ++c) {
+        const CpuStats &cs = res.cpu[c];
+        double util = res.makespan > 0 ? 100.0 * cs.busy / res.makespan : 0.0;
+        cout << left << setw(6) << c << right << setw(12) << cs.busy << setw(12) << fixed << setprecision(1) << util
+             << setw(12) << cs.dispatches << setw(10) << cs.steals << "\n";
+    }
+    cout << fixed << setprecision(3);
+    cout << "\nMakespan: " << res.makespan << "   Load imbalance (max/mean busy): " << res.imbalance
+         << "   Migrations: " << res.migrations << "\n";
+
+    printProcessMetrics(r, v, fullTable);
+}
+
+// ---------- Data entry ----------
+
+static vector<Process> enterProcesses() {
+    int n = readInt("Enter number of processes (1..100): ", 1, 100);
+    vector<Process> ps; ps.reserve(n);
+
+    bool autoPID = true; // we assign PIDs as 1..n in order
+
+    for (int i = 1; i <= n; ++i) {
+        cout << "\n--- Enter data for Process P" << i << " ---\n";
+        SimTime arr = readTime("Arrival time (>=0): ", 0, kMaxArrival);
+        SimTime burst = readTime("Burst time (>0): ", 1, kMaxBurst);
+        int prio = readInt("Priority (integer; smaller = higher): ", kMinPriority, kMaxPriority);
+        ps.push_back({i, arr, burst, prio});
+    }
+
+    // Optional: sort by PID (already is), return
+    return ps;
+}
+
+// Re-enters one process's data in place. since = the earliest time the edit
+// can affect a schedule (its old or new arrival, whichever is earlier).
+static const Process& editProcess(vector<Process>& ps, SimTime &since) {
+    int pid = readInt("PID to edit (1.." + to_string(ps.size()) + "): ", 1, (long long)ps.size());
+    Process &p = *find_if(ps.begin(), ps.end(), [&](const Process& x){ return x.pid == pid; });
+    cout << "Current: arrival " << p.arrival << ", burst " << p.burst << ", priority " << p.priority << "\n";
+    Process old = p;
+    while (true) {
+        p.arrival = readTime("Arrival time (>=0): ", 0, kMaxArrival);
+        p.burst = readTime("Burst time (>0): ", 1, kMaxBurst);
+        p.priority = readInt("Priority (integer; smaller = higher): ", kMinPriority, kMaxPriority);
+        TimeBudget budget;
+        for (const Process &x : ps) budget.add(x.arrival, x.burst);
+        if (budget.fits()) break;
+        cout << "\n[Error] " << budget.error() << ". Enter smaller values.\n\n";
+        p = old;
+    }
+    since = min(old.arrival, p.arrival);
+    return p;
+}
+
+static vector<Process> demoDataset() {
+    // A small, mixed dataset with staggered arrivals
+    // PID assigned 1..5 automatically
+    vector<Process> ps = {
+        {1, 0,  7, 3},
+        {2, 2,  4, 1},
+        {3, 4,  1, 4},
+        {4, 5,  4, 2},
+        {5, 6,  6, 5}
+    };
+    return ps;
+}
+
+// ---------- Synthetic workloads ----------
+// Random process sets for benchmarks and statistical evaluation. Times are
+// drawn as doubles and rounded; bursts are clamped to [1, kMaxBurst] and
+// arrivals to kMaxArrival, and a set past its TimeBudget is rejected.
+
+enum class ArrivalDist { Poisson, Bursty, AllAtZero };
+enum class BurstDist { Exponential, HeavyTailed };
+
+struct WorkloadSpec {
+    size_t n = 1000;
+    ArrivalDist arrivals = ArrivalDist::Poisson;
+    BurstDist bursts = BurstDist::Exponential;
+    double meanGap = 5.0;    // mean time between arrivals (Poisson process)
+    double meanBurst = 4.0;  // both burst distributions share this mean
+    int burstGroup = 32;     // Bursty: processes arriving together per burst
+    double tailIndex = 1.5;  // HeavyTailed: Pareto shape (alpha > 1)
+    int priorities = 8;      // priorities drawn uniformly from 0..priorities-1
+};
+
+static const char* arrivalDistName(ArrivalDist d) {
+    switch (d) {
+        case ArrivalDist::Poisson: return "poisson";
+        case ArrivalDist::Bursty:  return "bursty";
+        default:                   return "zero";
+    }
+}
+
+static const char* burstDistName(BurstDist d) {
+    return d == BurstDist::Exponential ? "exp" : "pareto";
+}
+
+// Fills ps (reusing its capacity) with w.n processes, PIDs 1..n
+static void generateWorkload(const WorkloadSpec& w, mt19937_64& rng, vector<Process>& ps) {
+    uniform_real_distribution<double> unit(0.0, 1.0);
+    auto open01 = [&]{ double u; do { u = unit(rng); } while (u <= 0.0); return u; };
+    uniform_int_distribution<int> prio(0, max(1, w.priorities) - 1);
+
+    // Pareto scale chosen so the mean matches meanBurst
+    double alpha = max(1.01, w.tailIndex);
+    double xm = w.meanBurst * (alpha - 1.0) / alpha;
+
+    ps.clear(); ps.reserve(w.n);
+    TimeBudget budget;
+    double t = 0.0;
+    for (size_t i = 0; i < w.n; ++i) {
+        if (w.arrivals == ArrivalDist::Poisson) {
+            t += -w.meanGap * log(open01());
+        } else if (w.arrivals == ArrivalDist::Bursty && i > 0 && i % max(1, w.burstGroup) == 0) {
+            t += -w.meanGap * max(1, w.burstGroup) * log(open01()); // same average rate, clumped
+        }
+        double b = (w.bursts == BurstDist::Exponential)
+            ? -w.meanBurst * log(open01())
+            : xm / pow(open01(), 1.0 / alpha);
+        SimTime burst = (SimTime)min<double>((double)kMaxBurst, max(1.0, round(b)));
+        SimTime arrival = (SimTime)min<double>((double)kMaxArrival, t);
+        budget.add(arrival, burst);
+        ps.push_back({(int)i + 1, arrival, burst, prio(rng)});
+    }
+    if (!budget.fits())
+        throw runtime_error("random workload of " + to_string(w.n) + " processes: " + budget.error());
+}
+
+// ---------- Trace files (batch mode) ----------
+// CSV traces hold one process per line, either "arrival,burst,priority" (PIDs
+// are assigned 1..N in file order) or "pid,arrival,burst,priority" (PIDs must
+// form 1..N, in any order). Blank lines, '#' comments and a leading header row
+// are skipped.
+// Binary traces are a 16-byte header -- magic "SCHT", u32 version (1), u64
+// record count -- followed by little-endian int32 {arrival, burst, priority}
+// records; PIDs are 1..N in file order. The records stay int32 under
+// SCHED_TIME64, so nanosecond-scale traces come in as CSV or a process set.
+// Both formats are streamed through one fixed-size buffer and parsed in place,
+// so the reader's memory stays bounded regardless of trace size.
+
+static const char     kTraceMagic[4] = {'S', 'C', 'H', 'T'};
+static const uint32_t kTraceVersion  = 1;
+
+struct TraceStats {
+    unsigned long long bytes = 0;
+    size_t records = 0;
+    double seconds = 0.0;
+};
+
+struct FileCloser { void operator()(FILE *f) const { if (f) fclose(f); } };
+using FilePtr = unique_ptr<FILE, FileCloser>;
+
+static FilePtr openFile(const string &path, const char *mode) {
+    FilePtr f(fopen(path.c_str(), mode));
+    if (!f) throw runtime_error("cannot open '" + path + "': " + strerror(errno));
+    return f;
+}
+
+// Sliding window over a file: callers consume bytes from [data(), data()+avail())
+// and refill() moves the unconsumed tail to the front before reading more.
+// live: refill() returns whatever one read(2) delivers instead of waiting for
+// a full buffer, so lines from a pipe are seen as soon as they are written.
+class ChunkReader {
+public:
+    explicit ChunkReader(FILE *f, size_t cap = 1 << 20, bool live = false)
+        : f_(f), buf_(cap), live_(live) {}
+
+    const char* data() const { return buf_.data() + pos_; }
+    size_t avail() const { return len_ - pos_; }
+    void consume(size_t k) { pos_ += k; }
+    bool eof() const { return eof_; }
+    unsigned long long bytesRead() const { return bytes_; }
+
+    // Returns false once the file is exhausted and nothing new was read.
+    bool refill() {
+        if (eof_) return false;
+        memmove(buf_.data(), buf_.data() + pos_, len_ - pos_);
+        len_ -= pos_; pos_ = 0;
+        if (len_ == buf_.size()) throw runtime_error("trace record exceeds the read buffer");
+        size_t got;
+        if (live_) {
+            ssize_t r;
+            do r = read(fileno(f_), buf_.data() + len_, buf_.size() - len_);
+            while (r < 0 && errno == EINTR);
+            if (r < 0) throw runtime_error(string("read error: ") + strerror(errno));
+            got = (size_t)r;
+        } else {
+            got = fread(buf_.data() + len_, 1, buf_.size() - len_, f_);
+        }
+        if (got == 0) { eof_ = true; return false; }
+        len_ += got; bytes_ += got;
+        return true;
+    }
+
+    // A complete line is buffered, so nextLine() will not read
+    bool hasLine() const { return memchr(data(), '\n', avail()) != nullptr; }
+
+    // Next line without its terminator; the view is valid until the next call.
+    bool nextLine(const char *&b, const char *&e) {
+        while (true) {
+            const char *nl = (const char*)memchr(data(), '\n', avail());
+            if (nl) { b = data(); e = nl; consume(nl - b + 1); return true; }
+            if (!refill()) {
+                if (avail() == 0) return false;
+                b = data(); e = b + avail(); consume(avail());
+                return true;
+            }
+        }
+    }
+
+private:
+    FILE *f_;
+    vector<char> buf_;
+    bool live_;
+    size_t pos_ = 0, len_ = 0;
+    bool eof_ = false;
+    unsigned long long bytes_ = 0;
+};
+
+static string traceError(size_t line, const string &msg) {
+    return "trace line " + to_string(line) + ": " + msg;
+}
+
+static void checkRange(long long v, long long lo, long long hi, const char *field, size_t line) {
+    if (v < lo || v > hi)
+        throw runtime_error(traceError(line, string(field) + " " + to_string(v) +
+                            " outside [" + to_string(lo) + ", " + to_string(hi) + "]"));
+}
+
+// Parses up to 4 comma-separated integers from [b,e). Returns the field
+// count, or -1 if the line is not purely numeric (e.g. a header row).
+static int parseCsvFields(const char *b, const char *e, long long out[4]) {
+    int k = 0;
+    const char *p = b;
+    while (true) {
+        while (p < e && (*p == ' ' || *p == '\t')) ++p;
+        bool neg = false;
+        if (p < e && (*p == '-' || *p == '+')) { neg = (*p == '-'); ++p; }
+        if (p == e || *p < '0' || *p > '9') return -1;
+        long long v = 0;
+        while (p < e && *p >= '0' && *p <= '9') {
+            if (v > (LLONG_MAX - 9) / 10) return -1;
+            v = v * 10 + (*p++ - '0');
+        }
+        if (k == 4) return -1;
+        out[k++] = neg ? -v : v;
+        while (p < e && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+        if (p == e) return k;
+        if (*p++ != ',') return -1;
+    }
+}
+
+// Makes explicit PIDs dense 1..N and returns the set in PID order.
+static vector<Process> orderByPid(vector<Process> ps) {
+    size_t n = ps.size();
+    vector<Process> out(n);
+    vector<bool> seen(n + 1, false);
+    for (const auto &p : ps) {
+        if (p.pid < 1 || (size_t)p.pid > n)
+            throw runtime_error("PID " + to_string(p.pid) + " outside 1.." + to_string(n) + " (PIDs must be dense)");
+        if (seen[p.pid]) throw runtime_error("duplicate PID " + to_string(p.pid));
+        seen[p.pid] = true;
+        out[p.pid - 1] = p;
+    }
+    return out;
+}
+
+// One trace record as written, before range checks. line is the CSV line or
+// the binary record number; without a PID column the PID is the position.
+struct TraceRow {
+    long long pid, arrival, burst, priority;
+    bool explicitPid;
+    size_t line;
+};
+
+// The bounds enterProcesses enforces, for row number `index` (0-based) of
+// the trace. PID density and uniqueness need the whole set (orderByPid).
+static Process checkRow(const TraceRow &r, size_t index) {
+    checkRange(r.arrival, 0, kMaxArrival, "arrival", r.line);
+    checkRange(r.burst, 1, kMaxBurst, "burst", r.line);
+    checkRange(r.priority, kMinPriority, kMaxPriority, "priority", r.line);
+    if (r.explicitPid) checkRange(r.pid, 1, INT_MAX, "pid", r.line);
+    return {r.explicitPid ? (int)r.pid : (int)index + 1, (SimTime)r.arrival, (SimTime)r.burst, (int)r.priority};
+}
+
+// Calls f(row) for each CSV data row, in file order; only the shape (3 or 4
+// integers, the same count on every row) is checked here.
+template <class F>
+static void forEachCsvRow(ChunkReader &in, F f) {
+    const char *b, *e;
+    size_t line = 0, records = 0;
+    int columns = 0;       // fixed by the first data row
+    bool explicitPid = false;
+    while (in.nextLine(b, e)) {
+        ++line;
+        const char *p = b;
+        while (p < e && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+        if (p == e || *p == '#') continue;
+
+        long long fs[4];
+        int k = parseCsvFields(p, e, fs);
+        if (k < 0 && columns == 0 && records == 0) continue; // header row
+        if (k != 3 && k != 4)
+            throw runtime_error(traceError(line, "expected 3 or 4 integer fields"));
+        if (columns == 0) { columns = k; explicitPid = (k == 4); }
+        else if (k != columns)
+            throw runtime_error(traceError(line, "expected " + to_string(columns) + " fields"));
+
+        const long long *v = explicitPid ? fs + 1 : fs;
+        records++;
+        f(TraceRow{explicitPid ? fs[0] : 0, v[0], v[1], v[2], explicitPid, line});
+    }
+}
+
+// Calls f(process, line) for each CSV record, in file order. PIDs are the
+// explicit column or 1..N by position; their density is not checked here.
+template <class F>
+static void forEachCsvRecord(ChunkReader &in, F f) {
+    size_t records = 0;
+    forEachCsvRow(in, [&](const TraceRow &r) { f(checkRow(r, records++), r.line); });
+}
+
+static void readCsvTrace(ChunkReader &in, vector<Process> &ps) {
+    bool explicitPid = false;
+    forEachCsvRecord(in, [&](const Process &p, size_t) {
+        if (p.pid != (int)ps.size() + 1) explicitPid = true;
+        ps.push_back(p);
+    });
+    if (explicitPid) ps = orderByPid(move(ps));
+}
+
+// Reads the header of a binary trace (the magic is checked by the caller)
+// and returns its record count.
+static uint64_t readBinaryHeader(ChunkReader &in) {
+    const size_t kHeader = 16;
+    while (in.avail() < kHeader && in.refill()) {}
+    if (in.avail() < kHeader) throw runtime_error("binary trace: truncated header");
+    uint32_t version; uint64_t count;
+    memcpy(&version, in.data() + 4, 4);
+    memcpy(&count, in.data() + 8, 8);
+    if (version != kTraceVersion)
+        throw runtime_error("binary trace: unsupported version " + to_string(version));
+    in.consume(kHeader);
+    if (count > (uint64_t)INT_MAX) throw runtime_error("binary trace: too many records");
+    return count;
+}
+
+// Calls f(row) for each of the `count` records after the header.
+template <class F>
+static void forEachBinaryRow(ChunkReader &in, uint64_t count, F f) {
+    const size_t kRecord = 12;
+    uint64_t done = 0;
+    while (done < count) {
+        if (in.avail() < kRecord && !in.refill()) break;
+        const char *p = in.data();
+        size_t k = min<size_t>(in.avail() / kRecord, count - done);
+        for (size_t r = 0; r < k; ++r, p += kRecord) {
+            int32_t v[3];
+            memcpy(v, p, sizeof v);
+            f(TraceRow{0, v[0], v[1], v[2], false, (size_t)++done});
+        }
+        in.consume(k * kRecord);
+    }
+    if (done != count)
+        throw runtime_error("binary trace: expected " + to_string(count) +
+                            " records, found " + to_string(done));
+}
+
+static void readBinaryTrace(ChunkReader &in, vector<Process> &ps) {
+    uint64_t count = readBinaryHeader(in);
+    ps.reserve(count);
+    forEachBinaryRow(in, count, [&](const TraceRow &r) { ps.push_back(checkRow(r, ps.size())); });
+}
+
+// format: "csv", "bin", or "" to detect from the file's magic bytes.
+static vector<Process> loadTrace(const string &path, const string &format, TraceStats &st) {
+    auto t0 = chrono::steady_clock::now();
+    FilePtr f = openFile(path, "rb");
+    ChunkReader in(f.get());
+    in.refill();
+
+    bool binary = (format == "bin");
+    if (format.empty())
+        binary = in.avail() >= 4 && memcmp(in.data(), kTraceMagic, 4) == 0;
+    else if (format != "csv" && format != "bin")
+        throw runtime_error("unknown trace format '" + format + "'");
+
+    vector<Process> ps;
+    if (binary) {
+        if (in.avail() < 4 || memcmp(in.data(), kTraceMagic, 4) != 0)
+            throw runtime_error("binary trace: bad magic in '" + path + "'");
+        readBinaryTrace(in, ps);
+    } else {
+        readCsvTrace(in, ps);
+    }
+    if (ferror(f.get())) throw runtime_error("read error on '" + path + "'");
+    // Rows passed checkRow one by one; the set as a whole must fit SimTime too
+    TimeBudget budget;
+    for (const Process &p : ps) budget.add(p.arrival, p.burst);
+    if (!budget.fits()) throw runtime_error("trace '" + path + "': " + budget.error());
+
+    st.bytes = in.bytesRead();
+    st.records = ps.size();
+    st.seconds = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    return ps;
+}
+
+// ---------- Pipelined ingestion ----------
+// pipeTrace overlaps reading, validation and simulation of a trace in
+// arrival order (batch --pipeline):
+//   reader thread     reads and parses the file into TraceRow batches
+//   validator thread  checkRow ranges, PID uniqueness and density, the
+//                     (arrival, PID) order an online engine needs and the
+//                     set's TimeBudget
+//   caller's thread   consume(batch) runs the engine on each Process batch
+// Stages hand batches over through SpscRing, whose slots swap vectors, so
+// a drained batch travels back to its producer with its capacity and the
+// steady state allocates nothing. A failing stage sets abort, which stops
+// the others, and its error is rethrown after all threads have joined. The
+// wall time approaches the slowest stage instead of the sum of all three.
+
+static const size_t kPipeBatch = 4096; // records per batch
+static const size_t kPipeSlots = 16;   // batches in flight per hand-off
+
+// Lock-free single-producer single-consumer ring. Each side caches the other
+// side's index and only reloads it when the ring looks full (or empty).
+template <class T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t slots) : slots_(slots) {}  // slots: a power of two
+
+    // Swaps item into the ring; false if it is full.
+    bool push(T &item) {
+        size_t t = tail_.load(memory_order_relaxed);
+        if (t - headCache_ == slots_.size()) {
+            headCache_ = head_.load(memory_order_acquire);
+            if (t - headCache_ == slots_.size()) return false;
+        }
+        swap(slots_[t & (slots_.size() - 1)], item);
+        tail_.store(t + 1, memory_order_release);
+        return true;
+    }
+    // Swaps the oldest item out; false if the ring is empty.
+    bool pop(T &item) {
+        size_t h = head_.load(memory_order_relaxed);
+        if (h == tailCache_) {
+            tailCache_ = tail_.load(memory_order_acquire);
+            if (h == tailCache_) return false;
+        }
+        swap(item, slots_[h & (slots_.size() - 1)]);
+        head_.store(h + 1, memory_order_release);
+        return true;
+    }
+    // The producer is done; pop() drains what is left.
+    void close() { closed_.store(true, memory_order_release); }
+
+    // Blocking forms: spin briefly, then yield. pushWait fails only on
+    // abort, popWait also once the ring is closed and empty.
+    bool pushWait(T &item, const atomic<bool> &abort) {
+        for (int spin = 0; !push(item); ++spin) {
+            if (abort.load(memory_order_relaxed)) return false;
+            if (spin > 64) this_thread::yield();
+        }
+        return true;
+    }
+    bool popWait(T &item, const atomic<bool> &abort) {
+        for (int spin = 0; !pop(item); ++spin) {
+            if (closed_.load(memory_order_acquire)) return pop(item);
+            if (abort.load(memory_order_relaxed)) return false;
+            if (spin > 64) this_thread::yield();
+        }
+        return true;
+    }
+
+private:
+    vector<T> slots_;
+    alignas(64) atomic<size_t> head_{0};  // consumer side
+    size_t tailCache_ = 0;
+    alignas(64) atomic<size_t> tail_{0};  // producer side
+    size_t headCache_ = 0;
+    atomic<bool> closed_{false};
+};
+
+struct PipelineStats {
+    unsigned long long bytes = 0;
+    size_t records = 0;
+    double wall = 0.0;
+    double busy[3] = {0.0, 0.0, 0.0};  // read+parse, validate, consume; waits excluded
+};
+
+// format: as loadTrace; path "-" reads stdin. consume(const vector<Process>&)
+// sees the whole trace in order, one batch at a time.
+template <class Consume>
+static void pipeTrace(const string &path, const string &format, Consume consume, PipelineStats &st) {
+    auto t0 = chrono::steady_clock::now();
+    FilePtr owned;
+    FILE *f = stdin;
+    if (path != "-") { owned = openFile(path, "rb"); f = owned.get(); }
+    if (format != "" && format != "csv" && format != "bin") throw runtime_error("unknown trace format '" + format + "'");
+
+    SpscRing<vector<TraceRow>> rows(kPipeSlots);
+    SpscRing<vector<Process>> procs(kPipeSlots);
+    atomic<bool> abort{false};
+    exception_ptr error[3];
+    auto now = [] { return chrono::steady_clock::now(); };
+    auto secs = [](chrono::steady_clock::time_point a, chrono::steady_clock::time_point b) {
+        return chrono::duration<double>(b - a).count();
+    };
+
+    thread reader([&] {
+        double waited = 0.0;
+        auto start = now();
+        try {
+            ChunkReader in(f);
+            in.refill();
+            bool binary = format == "bin" || (format.empty() && in.avail() >= 4 && memcmp(in.data(), kTraceMagic, 4) == 0);
+            if (binary && (in.avail() < 4 || memcmp(in.data(), kTraceMagic, 4) != 0))
+                throw runtime_error("binary trace: bad magic in '" + path + "'");
+            vector<TraceRow> batch;
+            batch.reserve(kPipeBatch);
+            auto row = [&](const TraceRow &r) {
+                batch.push_back(r);
+                if (batch.size() < kPipeBatch) return;
+                auto w = now();
+                if (!rows.pushWait(batch, abort)) throw runtime_error("pipeline aborted");
+                waited += secs(w, now());
+                batch.clear();
+                batch.reserve(kPipeBatch);
+            };
+            if (binary) forEachBinaryRow(in, readBinaryHeader(in), row);
+            else forEachCsvRow(in, row);
+            if (ferror(f)) throw runtime_error("read error on '" + path + "'");
+            if (!batch.empty()) rows.pushWait(batch, abort);
+            st.bytes = in.bytesRead();
+        } catch (...) {
+            if (!abort.exchange(true)) error[0] = current_exception();
+        }
+        rows.close();
+        st.busy[0] = secs(start, now()) - waited;
+    });
+
+    thread validator([&] {
+        double waited = 0.0;
+        auto start = now();
+        try {
+            vector<TraceRow> in;
+            vector<Process> out;
+            vector<uint64_t> seen;  // explicit PIDs, one bit each
+            size_t index = 0;
+            long long maxPid = 0, lastArrival = -1, lastPid = 0;
+            bool explicitPid = false;
+            TimeBudget budget;
+            while (true) {
+                auto w = now();
+                bool got = rows.popWait(in, abort);
+                waited += secs(w, now());
+                if (!got) break;
+                out.clear();
+                for (const TraceRow &r : in) {
+                    Process p = checkRow(r, index++);
+                    if (r.explicitPid) {
+                        explicitPid = true;
+                        size_t word = (size_t)p.pid >> 6;
+                        if (word >= seen.size()) seen.resize(max(word + 1, 2 * seen.size()), 0);
+                        uint64_t bit = uint64_t(1) << (p.pid & 63);
+                        if (seen[word] & bit) throw runtime_error(traceError(r.line, "duplicate PID " + to_string(p.pid)));
+                        seen[word] |= bit;
+                        maxPid = max<long long>(maxPid, p.pid);
+                    }
+                    if (p.arrival < lastArrival || (p.arrival == lastArrival && p.pid < lastPid))
+                        throw runtime_error(traceError(r.line, "P" + to_string(p.pid) + " at " + to_string((long long)p.arrival) +
+                                                       " is out of (arrival, pid) order; --pipeline needs a sorted trace"));
+                    lastArrival = p.arrival; lastPid = p.pid;
+                    budget.add(p.arrival, p.burst);
+                    if (!budget.fits()) throw runtime_error(traceError(r.line, budget.error()));
+                    out.push_back(p);
+                }
+                w = now();
+                bool sent = procs.pushWait(out, abort);
+                waited += secs(w, now());
+                if (!sent) break;
+            }
+            if (!abort.load() && explicitPid && (size_t)maxPid != index)
+                throw runtime_error("PID " + to_string(maxPid) + " outside 1.." + to_string(index) + " (PIDs must be dense)");
+            st.records = index;
+        } catch (...) {
+            if (!abort.exchange(true)) error[1] = current_exception();
+        }
+        procs.close();
+        st.busy[1] = secs(start, now()) - waited;
+    });
+
+    double waited = 0.0;
+    auto start = now();
+    try {
+        vector<Process> batch;
+        while (true) {
+            auto w = now();
+            bool got = procs.popWait(batch, abort);
+            waited += secs(w, now());
+            if (!got) break;
+            consume(batch);
+        }
+    } catch (...) {
+        if (!abort.exchange(true)) error[2] = current_exception();
+    }
+    st.busy[2] = secs(start, now()) - waited;
+    reader.join();
+    validator.join();
+    for (const exception_ptr &e : error)
+        if (e) rethrow_exception(e);
+    st.wall = secs(t0, now());
+}
+
+// ---------- Process-set files (memory-mapped) ----------
+// A process set stored as columns so runs can start straight from the page
+// cache without parsing. Layout (little-endian, all offsets in bytes):
+//   0  char magic[4] = "SCHP"     4  u32 version (1)
+//   8  u64 count                  16 u64 offset of pid[count]       (int32)
+//   24 u64 offset of arrival[]    32 u64 offset of burst[]          (time)
+//   40 u64 offset of priority[]   48 u64 offset of byArrival[count] (u32)
+//   56 u32 time width in bytes: 4 (int32; older files store 0) or 8 (int64)
+//   60 u32 reserved (0)
+// Columns start on 64-byte boundaries, rows are in PID order (pid[r] == r+1)
+// and byArrival is the (arrival, pid) order, matching ProcessView. A set is
+// only mapped by a build with the same time width (see SimTime).
+
+static const char     kSetMagic[4] = {'S', 'C', 'H', 'P'};
+static const uint32_t kSetVersion  = 1;
+static const size_t   kSetHeader   = 64;
+
+static bool hasMagic(const string &path, const char magic[4]) {
+    FilePtr f(fopen(path.c_str(), "rb"));
+    char m[4];
+    return f && fread(m, 1, 4, f.get()) == 4 && memcmp(m, magic, 4) == 0;
+}
+
+static const size_t kSetWidths[5] = {4, sizeof(SimTime), sizeof(SimTime), 4, 4};
+
+static void writeProcessSet(const string &path, const ProcessView &v) {
+    auto align = [](uint64_t x) { return (x + 63) & ~uint64_t(63); };
+    uint64_t off[5], at = kSetHeader;
+    for (int c = 0; c < 5; ++c) { off[c] = at; at += align(v.n * kSetWidths[c]); }
+
+    char header[kSetHeader] = {};
+    uint64_t count = v.n;
+    uint32_t timeWidth = sizeof(SimTime);
+    memcpy(header, kSetMagic, 4);
+    memcpy(header + 4, &kSetVersion, 4);
+    memcpy(header + 8, &count, 8);
+    memcpy(header + 16, off, sizeof off);
+    memcpy(header + 56, &timeWidth, 4);
+
+    FilePtr f = openFile(path, "wb");
+    static const char pad[64] = {};
+    const void *cols[5] = {v.pid, v.arrival, v.burst, v.priority, v.byArrival};
+    bool ok = fwrite(header, 1, kSetHeader, f.get()) == kSetHeader;
+    for (int c = 0; c < 5 && ok; ++c) {
+        uint64_t bytes = v.n * kSetWidths[c], padding = align(bytes) - bytes;
+        ok = fwrite(cols[c], kSetWidths[c], v.n, f.get()) == v.n &&
+             fwrite(pad, 1, padding, f.get()) == padding;
+    }
+    if (!ok || fflush(f.get()) != 0) throw runtime_error("write error on '" + path + "'");
+}
+
+// Read-only mapping of a process-set file; view() points into the mapping.
+class MappedProcessSet {
+public:
+    explicit MappedProcessSet(const string &path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw runtime_error("cannot open '" + path + "': " + strerror(errno));
+        struct stat sb;
+        if (fstat(fd, &sb) != 0) { close(fd); throw runtime_error("cannot stat '" + path + "'"); }
+        size_ = (size_t)sb.st_size;
+        if (size_ < kSetHeader) { close(fd); throw runtime_error("process set: truncated header in '" + path + "'"); }
+        base_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (base_ == MAP_FAILED) { base_ = nullptr; throw runtime_error("cannot map '" + path + "'"); }
+        madvise(base_, size_, MADV_WILLNEED);
+        try { validate(); } catch (...) { munmap(base_, size_); throw; }
+    }
+    ~MappedProcessSet() { if (base_) munmap(base_, size_); }
+    MappedProcessSet(const MappedProcessSet&) = delete;
+    MappedProcessSet& operator=(const MappedProcessSet&) = delete;
+
+    const ProcessView& view() const { return view_; }
+
+private:
+    void validate() {
+        const char *b = (const char*)base_;
+        uint32_t version, timeWidth; uint64_t count, off[5];
+        memcpy(&version, b + 4, 4);
+        memcpy(&count, b + 8, 8);
+        memcpy(off, b + 16, sizeof off);
+        memcpy(&timeWidth, b + 56, 4);
+        if (memcmp(b, kSetMagic, 4) != 0) throw runtime_error("process set: bad magic");
+        if (version != kSetVersion) throw runtime_error("process set: unsupported version " + to_string(version));
+        if (timeWidth == 0) timeWidth = 4;
+        if (timeWidth != sizeof(SimTime))
+            throw runtime_error("process set: " + to_string(8 * timeWidth) + "-bit times, but this build uses " +
+                                to_string(8 * sizeof(SimTime)) + "-bit times (see SCHED_TIME64)");
+        if (count > (uint64_t)INT_MAX) throw runtime_error("process set: too many records");
+        for (int c = 0; c < 5; ++c)
+            if (off[c] % kSetWidths[c] != 0 || off[c] < kSetHeader || off[c] > size_ || size_ - off[c] < count * kSetWidths[c])
+                throw runtime_error("process set: column outside the file");
+
+        view_.n = count;
+        view_.pid       = (const int32_t*)(b + off[0]);
+        view_.arrival   = (const SimTime*)(b + off[1]);
+        view_.burst     = (const SimTime*)(b + off[2]);
+        view_.priority  = (const int32_t*)(b + off[3]);
+        view_.byArrival = (const uint32_t*)(b + off[4]);
+
+        // Engines trust these invariants, so check them once up front
+        TimeBudget budget;
+        for (size_t r = 0; r < count; ++r) {
+            if (view_.pid[r] != (int32_t)(r + 1)) throw runtime_error("process set: rows not in PID order");
+            if (view_.burst[r] < 1) throw runtime_error("process set: non-positive burst for PID " + to_string(r + 1));
+            if (view_.arrival[r] < 0) throw runtime_error("process set: negative arrival for PID " + to_string(r + 1));
+            budget.add(view_.arrival[r], view_.burst[r]);
+            uint32_t k = view_.byArrival[r];
+            if (k >= count) throw runtime_error("process set: arrival index out of range");
+            if (r > 0) {
+                uint32_t j = view_.byArrival[r-1];
+                if (view_.arrival[j] > view_.arrival[k] || (view_.arrival[j] == view_.arrival[k] && j >= k))
+                    throw runtime_error("process set: arrival index not sorted");
+            }
+        }
+        budget.check();
+    }
+
+    void *base_ = nullptr;
+    size_t size_ = 0;
+    ProcessView view_;
+};
+
+// A trace or process set opened for simulation: a process set is used in
+// place, text/binary traces are parsed into cols. Reports what it did on
+// stderr.
+struct LoadedSet {
+    unique_ptr<MappedProcessSet> mapped;
+    ProcessColumns cols;
+    ProcessView view;
+};
+
+static void openProcessSet(const string &path, const string &format, LoadedSet &s) {
+    if (format.empty() && hasMagic(path, kSetMagic)) {
+        auto t0 = chrono::steady_clock::now();
+        s.mapped.reset(new MappedProcessSet(path));
+        s.view = s.mapped->view();
+        cerr << fixed << setprecision(3) << "[Info] Mapped " << s.view.n << " processes in "
+             << chrono::duration<double>(chrono::steady_clock::now() - t0).count() << " s\n";
+    } else {
+        TraceStats st;
+        makeColumns(loadTrace(path, format, st), s.cols);
+        s.view = s.cols.view();
+        double mb = st.bytes / (1024.0 * 1024.0);
+        cerr << fixed << setprecision(2)
+             << "[Info] Parsed " << st.records << " processes (" << mb << " MB) in "
+             << st.seconds << " s (" << (st.seconds > 0 ? mb / st.seconds : 0.0) << " MB/s)\n";
+    }
+}
+
+// ---------- Result files ----------
+// Flat columnar dump of a Result for analysis tools (numpy.memmap, Arrow
+// buffers, ...) instead of scraping the printed tables. Layout
+// (little-endian, all offsets in bytes):
+//   0  char magic[4] = "SCHR"     4  u32 version (1)
+//   8  u64 process count n        16 u64 segment count k
+//   24 f64 avg_wait               32 f64 avg_tat
+//   40 u64 offset of timeline[k]  (i32 pid, i32 start, i32 end; pid -1 = IDLE,
+//                                  -2 = context switch)
+//   48 u64 offset of completion[n]   56 u64 offset of waiting[n]
+//   64 u64 offset of tat[n]          72 u64 offset of response[n]
+//   80 u64 offset of algo name       88 u64 name length (UTF-8, no NUL)
+//   96 u32 time width in bytes: 4, or 8 for SCHED_TIME64 builds
+//   100..127 reserved (0)
+// The per-process columns are times in PID order (entry i is PID i+1). With
+// 8-byte times a timeline record is {i32 pid, 4 bytes padding, i64 start,
+// i64 end}. Blocks start on 64-byte boundaries; k is 0 for runs without a
+// timeline.
+
+static const char     kResultMagic[4] = {'S', 'C', 'H', 'R'};
+static const uint32_t kResultVersion  = 1;
+static const size_t   kResultHeader   = 128;
+
+static_assert(sizeof(Segment) == (sizeof(SimTime) == 4 ? 12 : 24), "timeline records are written as-is");
+
+// Each block goes out with one fwrite straight from the Result's vectors
+// (large writes bypass stdio's buffer), so nothing is copied or reformatted.
+// Timeline records are the exception when they need it: a compact timeline
+// is decoded into them a chunk at a time, and SCHED_TIME64 records, whose
+// padding after pid is never written in memory, are copied field by field
+// into the same zeroed chunk, so the file holds no stray heap bytes.
+static void writeResult(const string &path, const Result &r) {
+    auto align = [](uint64_t x) { return (x + 63) & ~uint64_t(63); };
+    uint64_t n = r.completion.empty() ? 0 : r.completion.size() - 1;
+    uint64_t k = r.packed.empty() ? r.timeline.size() : r.packed.size();
+
+    struct Block { const void *data; uint64_t bytes; };
+    Block blocks[6] = {
+        {r.timeline.data(), k * sizeof(Segment)},
+        {r.completion.data() + (n ? 1 : 0), n * sizeof(SimTime)},
+        {r.waiting.data() + (n ? 1 : 0), n * sizeof(SimTime)},
+        {r.tat.data() + (n ? 1 : 0), n * sizeof(SimTime)},
+        {r.response.data() + (n ? 1 : 0), n * sizeof(SimTime)},
+        {r.algo_name.data(), r.algo_name.size()},
+    };
+    uint64_t off[6], at = kResultHeader;
+    for (int b = 0; b < 6; ++b) { off[b] = at; at = align(at + blocks[b].bytes); }
+
+    char header[kResultHeader] = {};
+    uint64_t nameLen = r.algo_name.size();
+    uint32_t timeWidth = sizeof(SimTime);
+    memcpy(header, kResultMagic, 4);
+    memcpy(header + 4, &kResultVersion, 4);
+    memcpy(header + 8, &n, 8);
+    memcpy(header + 16, &k, 8);
+    memcpy(header + 24, &r.avg_wait, 8);
+    memcpy(header + 32, &r.avg_tat, 8);
+    memcpy(header + 40, off, sizeof off);
+    memcpy(header + 88, &nameLen, 8);
+    memcpy(header + 96, &timeWidth, 4);
+
+    FilePtr f = openFile(path, "wb");
+    static const char pad[64] = {};
+    auto writeRecords = [&](const auto &timeline) {
+        static const size_t kChunk = 4096;
+        unique_ptr<Segment[]> buf(new Segment[kChunk]);
+        memset(buf.get(), 0, kChunk * sizeof(Segment)); // padding bytes of TIME64 records stay 0
+        size_t m = 0;
+        bool good = true;
+        for (const Segment &s : timeline) {
+            buf[m].pid = s.pid; buf[m].start = s.start; buf[m].end = s.end;
+            if (++m == kChunk) { good = good && fwrite(buf.get(), sizeof(Segment), m, f.get()) == m; m = 0; }
+        }
+        return good && fwrite(buf.get(), sizeof(Segment), m, f.get()) == m;
+    };
+    const bool padded = sizeof(Segment) != sizeof(int) + 2 * sizeof(SimTime);
+    bool ok = fwrite(header, 1, kResultHeader, f.get()) == kResultHeader;
+    for (int b = 0; b < 6 && ok; ++b) {
+        uint64_t padding = align(off[b] + blocks[b].bytes) - off[b] - blocks[b].bytes;
+        bool written = b == 0 && !r.packed.empty() ? writeRecords(r.packed)
+                     : b == 0 && padded            ? writeRecords(r.timeline)
+                     : fwrite(blocks[b].data, 1, blocks[b].bytes, f.get()) == blocks[b].bytes;
+        ok = written && fwrite(pad, 1, padding, f.get()) == padding;
+    }
+    if (!ok || fflush(f.get()) != 0) throw runtime_error("write error on '" + path + "'");
+}
+
+// ---------- Gantt export (SVG/HTML) ----------
+// Timelines too long for the terminal chart can be written as an SVG image
+// (or an HTML page embedding it, for paths ending in .html/.htm), one row per
+// timeline, e.g. one per CPU. Rows are folded into at most kSvgWidth pixel
+// columns first (bucketTimeline), so the file size is bounded by the image
+// width however many segments there are. Each rect carries a tooltip with
+// its PID and time range; opacity shows the busy share.
+
+static const int kSvgWidth = 1200, kSvgRow = 26, kSvgLeft = 70, kSvgTop = 30;
+
+static bool endsWith(const string &s, const string &suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Timeline is a vector<Segment> or a CompactTimeline.
+template <class Timeline>
+static void exportGantt(const string &path, const string &title,
+                        const vector<const Timeline*> &rows, const vector<string> &names) {
+    long long total = 0;
+    for (auto *tl : rows) if (!tl->empty()) total = max<long long>(total, tl->back().end);
+    int cols = (int)min<long long>(kSvgWidth, max(total, 1LL));
+    double px = (double)kSvgWidth / cols;
+    int height = kSvgTop + (int)rows.size() * kSvgRow + 10;
+
+    FilePtr f = openFile(path, "w");
+    FILE *out = f.get();
+    bool html = endsWith(path, ".html") || endsWith(path, ".htm");
+    if (html)
+        fprintf(out, "<!DOCTYPE html>\n<html><head><meta charset=\"utf-8\"><title>%s</title></head>\n"
+                     "<body style=\"font-family:sans-serif\">\n<h3>%s</h3>\n", title.c_str(), title.c_str());
+    fprintf(out, "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"%d\" height=\"%d\" font-family=\"sans-serif\" font-size=\"11\">\n",
+            kSvgLeft + kSvgWidth + 20, height);
+
+    // Time axis: ten ticks across the top
+    for (int k = 0; k <= 10; ++k) {
+        double x = kSvgLeft + kSvgWidth * k / 10.0;
+        fprintf(out, "<line x1=\"%.1f\" y1=\"%d\" x2=\"%.1f\" y2=\"%d\" stroke=\"#bbb\"/>"
+                     "<text x=\"%.1f\" y=\"%d\" text-anchor=\"middle\">%lld</text>\n",
+                x, kSvgTop - 6, x, height - 10, x, kSvgTop - 10, scaleTime(total, k, 10));
+    }
+
+    for (size_t r = 0; r < rows.size(); ++r) {
+        int y = kSvgTop + (int)r * kSvgRow;
+        fprintf(out, "<text x=\"4\" y=\"%d\">%s</text>\n", y + kSvgRow / 2 + 4, names[r].c_str());
+        fprintf(out, "<rect x=\"%d\" y=\"%d\" width=\"%d\" height=\"%d\" fill=\"#f4f4f4\"/>\n",
+                kSvgLeft, y + 2, kSvgWidth, kSvgRow - 4);
+
+        vector<GanttColumn> col = bucketTimeline(*rows[r], total, cols);
+        // One rect per run of columns with the same PID and busy decile
+        auto decile = [](const GanttColumn &gc) { return gc.span ? (int)(10 * gc.busy / gc.span) : 0; };
+        for (int c = 0; c < cols; ) {
+            int e = c;
+            while (e < cols && col[e].pid == col[c].pid && decile(col[e]) == decile(col[c])) ++e;
+            if (col[c].pid != -1) {
+                int pid = col[c].pid;
+                double x = kSvgLeft + c * px, w = (e - c) * px;
+                string lab = segmentLabel(pid);
+                char fill[32] = "#777"; // context switches in grey
+                if (pid != kSwitchPid) snprintf(fill, sizeof fill, "hsl(%d,65%%,55%%)", (int)(pid * 137.508) % 360);
+                fprintf(out, "<rect x=\"%.2f\" y=\"%d\" width=\"%.2f\" height=\"%d\" fill=\"%s\" fill-opacity=\"%.1f\">"
+                             "<title>%s [%lld, %lld)</title></rect>\n",
+                        x, y + 2, w, kSvgRow - 4, fill, max(0.2, decile(col[c]) / 10.0),
+                        lab.c_str(), scaleTime(total, c, cols), scaleTime(total, e, cols));
+                if (w >= 7.0 * lab.size() + 4)
+                    fprintf(out, "<text x=\"%.2f\" y=\"%d\" text-anchor=\"middle\">%s</text>\n",
+                            x + w / 2, y + kSvgRow / 2 + 4, lab.c_str());
+            }
+            c = e;
+        }
+    }
+
+    fprintf(out, "</svg>\n");
+    if (html) fprintf(out, "</body></html>\n");
+    if (ferror(out)) throw runtime_error("write error on '" + path + "'");
+}
+
+// ---------- Worker pool ----------
+// A fixed set of threads shared by every batch feature that fans work out
+// (comparisons, sweeps, ...). Results come back through futures, so callers
+// decide the output order. Tasks must not wait on other pool tasks.
+
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned threads) {
+        if (threads == 0) threads = 1;
+        for (unsigned k = 0; k < threads; ++k) workers_.emplace_back([this]{ work(); });
+    }
+    ~ThreadPool() {
+        { lock_guard<mutex> lk(m_); stop_ = true; }
+        cv_.notify_all();
+        for (auto &w : workers_) w.join();
+    }
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return workers_.size(); }
+
+    template <class F>
+    auto submit(F f) -> future<decltype(f())> {
+        using R = decltype(f());
+        auto task = make_shared<packaged_task<R()>>(move(f));
+        future<R> res = task->get_future();
+        { lock_guard<mutex> lk(m_); tasks_.push([task]{ (*task)(); }); }
+        cv_.notify_one();
+        return res;
+    }
+
+private:
+    void work() {
+        while (true) {
+            function<void()> job;
+            {
+                unique_lock<mutex> lk(m_);
+                cv_.wait(lk, [this]{ return stop_ || !tasks_.empty(); });
+                if (tasks_.empty()) return; // stopping and drained
+                job = move(tasks_.front()); tasks_.pop();
+            }
+            job();
+        }
+    }
+
+    vector<thread> workers_;
+    queue<function<void()>> tasks_;
+    mutex m_;
+    condition_variable cv_;
+    bool stop_ = false;
+};
+
+// Process-wide pool, started on first use with one thread per hardware thread.
+static ThreadPool& workerPool() {
+    static ThreadPool pool(thread::hardware_concurrency());
+    return pool;
+}
+
+// ---------- Round Robin quantum sweep ----------
+// Evaluates many quanta over one shared ProcessView on the worker pool. Only
+// the averages are needed, so each run coalesces slices and accumulates the
+// waiting/turnaround sums inline instead of building a timeline.
+
+struct SweepPoint {
+    int quantum = 0;
+    bool pruned = false;   // abandoned: already worse than the best complete run
+    double avg_wait = 0.0, avg_tat = 0.0;
+};
+
+// bestWait (optional) holds the smallest complete waiting-time sum seen so far
+// (saturated at LLONG_MAX); a run stops as soon as its partial sum exceeds it.
+struct SweepSink {
+    const ProcessView& v;
+    const atomic<long long>* bestWait;
+    TimeSum sumWait = 0, sumTat = 0;
+
+    bool segment(int pid, SimTime, SimTime end, bool finished) {
+        if (!finished) return true;
+        SimTime tat = max<SimTime>(0, end - v.arrival[pid-1]);
+        sumTat += tat;
+        sumWait += max<SimTime>(0, tat - v.burst[pid-1]);
+        return !bestWait || sumWait <= bestWait->load(memory_order_relaxed);
+    }
+};
+
+static SweepPoint sweepRR(const ProcessView& v, int quantum, atomic<long long>* bestWait,
+                          const DispatchCost& dc = DispatchCost()) {
+    SweepPoint pt; pt.quantum = quantum;
+    SweepSink sink{v, bestWait};
+    // Pool workers outlive the sweep, so each keeps its scratch across quanta
+    static thread_local EngineScratch scratch;
+    bool done = dc.none() ? simulateRR(v, quantum, true, sink, NoCheckpoints(), nullptr, NoSwitchCost(), &scratch)
+                          : simulateRR(v, quantum, true, sink, NoCheckpoints(), nullptr, SwitchCost{dc}, &scratch);
+    if (!done) { pt.pruned = true; return pt; }
+    TimeSum sumWait = sink.sumWait, sumTat = sink.sumTat;
+
+    if (bestWait) {
+        long long mine = (long long)min<TimeSum>(sumWait, LLONG_MAX);
+        long long cur = bestWait->load(memory_order_relaxed);
+        while (mine < cur && !bestWait->compare_exchange_weak(cur, mine, memory_order_relaxed)) {}
+    }
+    if (v.n > 0) { pt.avg_wait = (double)sumWait / v.n; pt.avg_tat = (double)sumTat / v.n; }
+    return pt;
+}
+
+// Parses "1..256", "1,2,4,8" or mixes such as "1..8,16,32" into quanta.
+static bool parseQuantumList(const string &spec, vector<int> &out) {
+    const long long kMaxPoints = 100'000;
+    stringstream ss(spec);
+    string item;
+    while (getline(ss, item, ',')) {
+        long long lo, hi; char *end;
+        size_t dots = item.find("..");
+        lo = strtoll(item.c_str(), &end, 10);
+        if (dots == string::npos) {
+            if (*end || item.empty()) return false;
+            hi = lo;
+        } else {
+            if (end != item.c_str() + dots) return false;
+            const char *h = item.c_str() + dots + 2;
+            hi = strtoll(h, &end, 10);
+            if (*end || !*h) return false;
+        }
+        if (lo < 1 || hi > kMaxQuantum || lo > hi || (long long)out.size() + (hi - lo + 1) > kMaxPoints) return false;
+        for (long long q = lo; q <= hi; ++q) out.push_back((int)q);
+    }
+    return !out.empty();
+}
+
+// argminOnly: report just the best quantum and prune hopeless runs early.
+static void sweepQuanta(const ProcessView& ps, const vector<int>& quanta, bool argminOnly,
+                        const DispatchCost& dc = DispatchCost()) {
+    atomic<long long> best(LLONG_MAX);
+    ThreadPool &pool = workerPool();
+    vector<future<SweepPoint>> jobs;
+    jobs.reserve(quanta.size());
+    for (int q : quanta)
+        jobs.push_back(pool.submit([&ps, q, &best, argminOnly, &dc]{ return sweepRR(ps, q, argminOnly ? &best : nullptr, dc); }));
+
+    vector<SweepPoint> pts;
+    pts.reserve(jobs.size());
+    for (auto &j : jobs) pts.push_back(j.get());
+
+    const SweepPoint *bestPt = nullptr;
+    double worst = 0.0;
+    for (const auto &pt : pts) {
+        if (pt.pruned) continue;
+        if (!bestPt || pt.avg_wait < bestPt->avg_wait) bestPt = &pt;
+        worst = max(worst, pt.avg_wait);
+    }
+
+    cout << fixed << setprecision(3);
+    if (!argminOnly) {
+        const int kBar = 40;
+        cout << "\n=== Round Robin Quantum Sweep (" << ps.n << " processes";
+        if (!dc.none()) cout << ", switch cost " << dc.cost << ", warmup " << dc.warmup;
+        cout << ") ===\n";
+        cout << right << setw(8) << "Quantum" << setw(16) << "Avg Waiting" << setw(18) << "Avg Turnaround"
+             << "  Waiting curve\n";
+        cout << string(8+16+18+2+kBar, '-') << "\n";
+        for (const auto &pt : pts) {
+            int w = worst > 0 ? (int)round(pt.avg_wait / worst * kBar) : 0;
+            cout << right << setw(8) << pt.quantum << setw(16) << pt.avg_wait << setw(18) << pt.avg_tat
+                 << "  " << string(w, '#') << "\n";
+        }
+    } else {
+        size_t pruned = count_if(pts.begin(), pts.end(), [](const SweepPoint& p){ return p.pruned; });
+        cout << "\n[Info] Swept " << pts.size() << " quanta (" << pruned << " pruned early).\n";
+    }
+    if (bestPt)
+        cout << "\nBest quantum by Average Waiting Time: q=" << bestPt->quantum
+             << " (avg wait " << bestPt->avg_wait << ", avg turnaround " << bestPt->avg_tat << ")\n\n";
+}
+
+// ---------- Comparison module ----------
+// Algorithms can be ranked by any per-run statistic; names on the command
+// line and in the menu are "<stat>-<series>" (avg, p50, p90, p99, p99.9, max,
+// stddev x wait, tat, response) or "fairness".
+
+enum class RankStat { Mean, P50, P90, P99, P999, Max, Stddev, Fairness };
+enum class RankSeries { Wait, Turnaround, Response };
+
+struct RankMetric {
+    RankStat stat = RankStat::Mean;
+    RankSeries series = RankSeries::Wait;
+
+    bool operator==(const RankMetric& o) const {
+        return stat == o.stat && (stat == RankStat::Fairness || series == o.series);
+    }
+};
+
+static bool parseRankMetric(const string &spec, RankMetric &m) {
+    if (spec == "fairness") { m.stat = RankStat::Fairness; return true; }
+    size_t dash = spec.rfind('-');
+    if (dash == string::npos) return false;
+    string stat = spec.substr(0, dash), series = spec.substr(dash + 1);
+    static const pair<const char*, RankStat> stats[] = {
+        {"avg", RankStat::Mean}, {"p50", RankStat::P50}, {"p90", RankStat::P90}, {"p99", RankStat::P99},
+        {"p99.9", RankStat::P999}, {"max", RankStat::Max}, {"stddev", RankStat::Stddev}};
+    auto st = find_if(begin(stats), end(stats), [&](const pair<const char*, RankStat>& x){ return stat == x.first; });
+    if (st == end(stats)) return false;
+    if (series == "wait")          m.series = RankSeries::Wait;
+    else if (series == "tat")      m.series = RankSeries::Turnaround;
+    else if (series == "response") m.series = RankSeries::Response;
+    else return false;
+    m.stat = st->second;
+    return true;
+}
+
+static string rankLabel(const RankMetric &m) {
+    if (m.stat == RankStat::Fairness) return "Fairness (Jain)";
+    static const char *stats[] = {"Avg", "p50", "p90", "p99", "p99.9", "Max", "Stddev"};
+    static const char *series[] = {"Waiting", "Turnaround", "Response"};
+    return string(stats[(int)m.stat]) + " " + series[(int)m.series];
+}
+
+// What the comparison table shows of a run, in a form that merges: the
+// distributed grid pools the runs of one configuration over many traces into
+// one summary, histograms and all.
+struct RunSummary {
+    string name;
+    RunStats stats;
+    TimeSum makespan = 0, switchTime = 0;
+
+    void merge(const RunSummary& o) {
+        stats.merge(o.stats);
+        makespan += o.makespan; switchTime += o.switchTime;
+    }
+};
+
+static RunSummary summarize(const Result& r) {
+    RunSummary s;
+    s.name = r.algo_name;
+    s.stats = r.stats;
+    s.makespan = r.completion.empty() ? 0 : *max_element(r.completion.begin(), r.completion.end());
+    s.switchTime = r.switch_time;
+    return s;
+}
+
+static double rankValue(const RunSummary &r, const RankMetric &m) {
+    if (m.stat == RankStat::Fairness) return r.stats.fairness();
+    const LatencyHistogram &h = m.series == RankSeries::Wait ? r.stats.wait
+                              : m.series == RankSeries::Turnaround ? r.stats.tat : r.stats.response;
+    switch (m.stat) {
+        case RankStat::Mean:   return h.mean(); // exact integer sum over the count
+        case RankStat::P50:    return h.quantile(0.50);
+        case RankStat::P90:    return h.quantile(0.90);
+        case RankStat::P99:    return h.quantile(0.99);
+        case RankStat::P999:   return h.quantile(0.999);
+        case RankStat::Max:    return h.maximum();
+        case RankStat::Stddev: return h.stddev();
+        default:               return 0.0;
+    }
+}
+
+// The ranked table shared by compareAlgorithms and the distributed grid.
+static void printComparison(const vector<RunSummary>& runs, const RankMetric& rank, const DispatchCost& dc) {
+    // The table always shows these; the ranking metric gets a column if it
+    // is not one of them.
+    vector<RankMetric> cols(4);
+    cols[1].series = RankSeries::Turnaround;
+    cols[2].stat = RankStat::P99;
+    cols[3].stat = RankStat::P99; cols[3].series = RankSeries::Response;
+    size_t key = find(cols.begin(), cols.end(), rank) - cols.begin();
+    if (key == cols.size()) cols.push_back(rank);
+
+    // With a switch cost, a last column shows the switch share of the schedule
+    struct Row { string name; vector<double> val; double switchShare; };
+    vector<Row> rows;
+    int width = 28;
+    for (const auto &r : runs) {
+        Row row{r.name, {}, r.makespan > 0 ? 100.0 * (double)r.switchTime / (double)r.makespan : 0.0};
+        for (const auto &c : cols) row.val.push_back(rankValue(r, c));
+        rows.push_back(move(row));
+        width = max(width, (int)r.name.size() + 1);
+    }
+    if (rows.empty()) return;
+
+    // Lower is better except for fairness
+    bool higher = rank.stat == RankStat::Fairness;
+    stable_sort(rows.begin(), rows.end(), [&](const Row& a, const Row& b){
+        return higher ? a.val[key] > b.val[key] : a.val[key] < b.val[key];
+    });
+
+    cout << "\n=== Algorithm Comparison (ranked by " << rankLabel(rank) << ", "
+         << (higher ? "higher" : "lower") << " is better) ===\n";
+    if (!dc.none())
+        cout << "Context switch cost " << dc.cost << ", cache warmup " << dc.warmup << "\n";
+    cout << left << setw(width) << "Algorithm" << right;
+    for (const auto &c : cols) cout << setw(18) << rankLabel(c);
+    if (!dc.none()) cout << setw(12) << "Switch %";
+    cout << "\n" << string(width + 18 * cols.size() + (dc.none() ? 0 : 12), '-') << "\n";
+    cout << fixed << setprecision(3);
+    for (auto &rw : rows) {
+        cout << left << setw(width) << rw.name << right;
+        for (double x : rw.val) cout << setw(18) << x;
+        if (!dc.none()) cout << setw(12) << setprecision(1) << rw.switchShare << setprecision(3);
+        cout << "\n";
+    }
+
+    cout << "\nBest by " << rankLabel(rank) << ": " << rows.front().name << "\n\n";
+}
+
+static void compareAlgorithms(const ProcessView& ps, int q, const RankMetric& rank = RankMetric(),
+                              const DispatchCost& dc = DispatchCost()) {
+    // The engines only read ps, so they can all run at once; gathering the
+    // futures in a fixed order keeps the output deterministic.
+    ThreadPool &pool = workerPool();
+    // Only the metrics are shown, so skip building timelines.
+    vector<future<Result>> jobs;
+    jobs.push_back(pool.submit([&]{ return runFCFS<MetricsSink>(ps, dc); }));
+    jobs.push_back(pool.submit([&]{ return runSJF<MetricsSink>(ps, dc); }));
+    jobs.push_back(pool.submit([&]{ return runPriorityNP<MetricsSink>(ps, dc); }));
+    jobs.push_back(pool.submit([&]{ return runRR<MetricsSink>(ps, q, true, dc); }));
+    jobs.push_back(pool.submit([&]{ return runSRTF<MetricsSink>(ps, dc); }));
+    jobs.push_back(pool.submit([&]{ return runPriorityP<MetricsSink>(ps, dc); }));
+    jobs.push_back(pool.submit([&]{ return runMLFQ<MetricsSink>(ps, defaultMlfq(q), dc); }));
+    jobs.push_back(pool.submit([&]{ return runLottery<MetricsSink>(ps, q, kLotterySeed, dc); }));
+    jobs.push_back(pool.submit([&]{ return runStride<MetricsSink>(ps, q, dc); }));
+
+    vector<RunSummary> runs;
+    for (auto &j : jobs) runs.push_back(summarize(j.get()));
+    printComparison(runs, rank, dc);
+}
+
+// ---------- Monte Carlo evaluation ----------
+// A single process set says little about which algorithm is better in
+// general, so this draws K random workloads shaped like a template set (see
+// fitWorkload), runs every algorithm on each and reports the mean and 95%
+// confidence interval of the per-workload averages. Workloads are cut into a
+// fixed number of shards, each with its own RNG stream seeded from (seed,
+// shard), so the numbers depend on the seed and K but not on the thread
+// count. Runs keep only the waiting/turnaround sums (SweepSink), each shard
+// reuses one set of buffers for all its workloads, and shards share nothing
+// until they are merged in order at the end.
+
+static const int kMcAlgos = 9;
+static const size_t kMcShards = 256;
+static const long long kMaxMcWorkloads = 10'000'000;
+
+struct MonteCarloSpec {
+    WorkloadSpec workload;
+    size_t workloads = 1000;
+    int quantum = 4;         // Round Robin, and the base of the default MLFQ
+    uint64_t seed = 1;
+};
+
+// Same size, mean gap between arrivals, mean burst and priority range as the
+// template; a template whose processes all arrive together stays that way.
+static WorkloadSpec fitWorkload(const ProcessView& v) {
+    WorkloadSpec w;
+    if (v.n == 0) return w;
+    w.n = v.n;
+    TimeSum bursts = 0;
+    long long lo = v.priority[0], hi = v.priority[0];
+    for (size_t r = 0; r < v.n; ++r) {
+        bursts += v.burst[r];
+        lo = min<long long>(lo, v.priority[r]); hi = max<long long>(hi, v.priority[r]);
+    }
+    w.meanBurst = (double)bursts / v.n;
+    w.priorities = (int)min<long long>(hi - lo + 1, INT_MAX);
+    SimTime first = v.arrival[v.byArrival[0]], last = v.arrival[v.byArrival[v.n-1]];
+    if (first == last) w.arrivals = ArrivalDist::AllAtZero;
+    else w.meanGap = (double)(last - first) / (v.n - 1);
+    return w;
+}
+
+// Running mean and variance (Welford); merge() combines two shards.
+struct MeanVar {
+    uint64_t n = 0;
+    double mean = 0.0, m2 = 0.0;
+
+    void add(double x) {
+        double d = x - mean;
+        mean += d / ++n;
+        m2 += d * (x - mean);
+    }
+    void merge(const MeanVar& o) {
+        if (o.n == 0) return;
+        uint64_t total = n + o.n;
+        double d = o.mean - mean;
+        mean += d * o.n / total;
+        m2 += o.m2 + d * d * ((double)n * o.n / total);
+        n = total;
+    }
+    double variance() const { return n > 1 ? m2 / (n - 1) : 0.0; }
+    // Half-width of the normal-approximation 95% interval for the mean
+    double ci95() const { return n > 1 ? 1.96 * sqrt(variance() / n) : 0.0; }
+};
+
+struct McTally {
+    MeanVar wait[kMcAlgos], tat[kMcAlgos];
+    MeanVar gap[kMcAlgos][kMcAlgos]; // gap[a][b]: avg wait of b minus a's, per workload
+    uint64_t wins[kMcAlgos] = {};    // workloads where a has (one of) the lowest avg wait
+
+    void merge(const McTally& o) {
+        for (int a = 0; a < kMcAlgos; ++a) {
+            wait[a].merge(o.wait[a]); tat[a].merge(o.tat[a]); wins[a] += o.wins[a];
+            for (int b = 0; b < kMcAlgos; ++b) gap[a][b].merge(o.gap[a][b]);
+        }
+    }
+};
+
+// In the order compareAlgorithms submits them
+static vector<string> monteCarloNames(int q) {
+    return {"FCFS", "SJF (Non-Preemptive)", "Priority (Non-Preemptive)",
+            "Round Robin (q=" + to_string(q) + ")", "SRTF (Preemptive SJF)", "Priority (Preemptive)",
+            mlfqName(defaultMlfq(q)), "Lottery (q=" + to_string(q) + ")", "Stride (q=" + to_string(q) + ")"};
+}
+
+static void evaluateWorkload(const ProcessView& v, int q, const MlfqOptions& mlfq, EngineScratch& scratch,
+                             double wait[kMcAlgos], double tat[kMcAlgos]) {
+    auto run = [&](int a, auto simulate) {
+        SweepSink sink{v, nullptr};
+        simulate(sink);
+        wait[a] = (double)sink.sumWait / v.n;
+        tat[a] = (double)sink.sumTat / v.n;
+    };
+    NoCheckpoints none;
+    NoSwitchCost free;
+    run(0, [&](SweepSink& s){ simulateFCFS(v, s); });
+    run(1, [&](SweepSink& s){ simulateSJF(v, s, none, nullptr, free, &scratch); });
+    run(2, [&](SweepSink& s){ simulatePriorityNP(v, s, none, nullptr, free, &scratch); });
+    run(3, [&](SweepSink& s){ simulateRR(v, q, true, s, none, nullptr, free, &scratch); });
+    run(4, [&](SweepSink& s){ simulateSRTF(v, s, free, &scratch); });
+    run(5, [&](SweepSink& s){ simulatePriorityP(v, s, free, &scratch); });
+    run(6, [&](SweepSink& s){ simulateMLFQ(v, mlfq, s, free, &scratch); });
+    run(7, [&](SweepSink& s){ simulateLottery(v, q, kLotterySeed, s, free, &scratch); });
+    run(8, [&](SweepSink& s){ simulateStride(v, q, s, free, &scratch); });
+}
+
+static McTally monteCarloShard(const MonteCarloSpec& mc, size_t shard, size_t first, size_t last) {
+    seed_seq seq{(uint32_t)mc.seed, (uint32_t)(mc.seed >> 32), (uint32_t)shard};
+    mt19937_64 rng(seq);
+    MlfqOptions mlfq = defaultMlfq(mc.quantum);
+    McTally t;
+    double wait[kMcAlgos], tat[kMcAlgos];
+    // Reused for every workload of the shard: no allocation after the first
+    vector<Process> ps;
+    ProcessColumns cols;
+    EngineScratch scratch;
+    for (size_t k = first; k < last; ++k) {
+        generateWorkload(mc.workload, rng, ps);
+        makeColumns(ps, cols);
+        evaluateWorkload(cols.view(), mc.quantum, mlfq, scratch, wait, tat);
+        double best = *min_element(wait, wait + kMcAlgos);
+        for (int a = 0; a < kMcAlgos; ++a) {
+            t.wait[a].add(wait[a]); t.tat[a].add(tat[a]);
+            if (wait[a] == best) t.wins[a]++;
+            for (int b = 0; b < kMcAlgos; ++b) t.gap[a][b].add(wait[b] - wait[a]);
+        }
+    }
+    return t;
+}
+
+static void monteCarlo(const MonteCarloSpec& mc) {
+    const WorkloadSpec &w = mc.workload;
+    if (mc.workloads == 0 || w.n == 0) throw runtime_error("Monte Carlo evaluation needs at least one workload and process");
+
+    auto t0 = chrono::steady_clock::now();
+    ThreadPool &pool = workerPool();
+    size_t shards = min(kMcShards, mc.workloads);
+    vector<future<McTally>> jobs;
+    jobs.reserve(shards);
+    for (size_t s = 0; s < shards; ++s) {
+        size_t first = mc.workloads * s / shards, last = mc.workloads * (s + 1) / shards;
+        jobs.push_back(pool.submit([&mc, s, first, last]{ return monteCarloShard(mc, s, first, last); }));
+    }
+    // Every shard reads mc, so all of them finish before a failure (a
+    // workload past its TimeBudget) is rethrown
+    McTally t;
+    exception_ptr error;
+    for (auto &j : jobs) {
+        try { t.merge(j.get()); }
+        catch (...) { if (!error) error = current_exception(); }
+    }
+    if (error) rethrow_exception(error);
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+
+    vector<string> names = monteCarloNames(mc.quantum);
+    int order[kMcAlgos];
+    iota(order, order + kMcAlgos, 0);
+    stable_sort(order, order + kMcAlgos, [&](int a, int b){ return t.wait[a].mean < t.wait[b].mean; });
+    int best = order[0];
+
+    auto ci = [](double mean, double half) {
+        ostringstream os;
+        os << fixed << setprecision(3) << mean << " +/- " << half;
+        return os.str();
+    };
+    cout << "\n=== Monte Carlo Evaluation (" << mc.workloads << " " << arrivalDistName(w.arrivals) << "/"
+         << burstDistName(w.bursts) << " workloads of " << w.n << " processes, seed " << mc.seed << ") ===\n";
+    cout << left << setw(28) << "Algorithm" << right << setw(24) << "Avg Waiting (95% CI)"
+         << setw(26) << "Avg Turnaround (95% CI)" << setw(24) << "Waiting vs best" << setw(10) << "Best in" << "\n";
+    cout << string(28 + 24 + 26 + 24 + 10, '-') << "\n";
+    for (int a : order) {
+        double share = 100.0 * t.wins[a] / mc.workloads;
+        ostringstream pct; pct << fixed << setprecision(1) << share << "%";
+        cout << left << setw(28) << names[a] << right << setw(24) << ci(t.wait[a].mean, t.wait[a].ci95())
+             << setw(26) << ci(t.tat[a].mean, t.tat[a].ci95())
+             << setw(24) << (a == best ? string("-") : ci(t.gap[best][a].mean, t.gap[best][a].ci95()))
+             << setw(10) << pct.str() << "\n";
+    }
+
+    // The paired gap to the runner-up decides whether the ranking means anything
+    const MeanVar &lead = t.gap[best][order[1]];
+    cout << "\nBest by Average Waiting Time: " << names[best] << " (ahead of " << names[order[1]]
+         << " by " << ci(lead.mean, lead.ci95()) << ", "
+         << (lead.n > 1 && lead.mean > lead.ci95() ? "significant" : "not significant") << " at 95%)\n";
+    cout << fixed << setprecision(2) << "[Info] " << mc.workloads * kMcAlgos << " runs in " << secs << " s on "
+         << pool.size() << " threads (" << (secs > 0 ? mc.workloads * kMcAlgos / secs : 0.0) << " runs/s)\n\n";
+}
+
+// ---------- Distributed grid ----------
+// A parameter grid -- algorithms x quanta x traces x CPU counts -- too big for
+// one machine is spread over several. Every machine runs
+// `scheduler --worker PORT --bind ADDR --trace-root DIR`; the coordinator (batch --workers) expands the
+// grid into one work unit per (trace, algorithm, quantum, CPU count), hands
+// units to the workers over TCP and merges the returned summaries per
+// configuration, pooling all traces, into compareAlgorithms' ranked table.
+// Summaries carry the run's histograms, which merge exactly, so a pooled p99
+// is the p99 over every process of every trace. Traces travel by path and
+// must be readable under that path on every worker (shared storage). A unit
+// whose worker drops the connection or reports an error goes back to the
+// queue and is retried, up to `retries` times, on whichever worker is free;
+// a worker that cannot be reached is given up after kGridConnectTries.
+//
+// Wire format (little-endian): each message is a u32 length and a payload,
+//   unit:    char[4] "SCHU", u32 version, u32 time width, str trace,
+//            str format, str algo, i32 quantum, i32 cpus, u8 flags
+//            (1 coalesce, 2 steal, 4 least-loaded), i64 switch cost,
+//            i64 warmup, u64 lottery seed
+//   summary: char[4] "SCHS", u8 status, then for status 0: str name,
+//            i128 makespan, i128 switch time, then the wait, turnaround and
+//            response histograms (LatencyHistogram::encode) and f64 slowdown
+//            sum and sum of squares; for status 1: str error
+// where str is a u32 byte count and the bytes, and i128 two u64 halves, low
+// half first. One connection carries one unit at a time; a worker serves
+// each connection on its own thread, up to kGridMaxConnections, so listing a
+// worker twice in --workers runs two units on it at once.
+//
+// Trust model: the protocol has no authentication, and a unit names a file
+// for the worker to open. A worker therefore listens on loopback unless
+// started with --bind, and a --bind address other than loopback needs
+// --trace-root, outside of which it opens nothing. Expose a worker only on a
+// network whose every host may read the files under its trace root.
+
+static const char     kUnitMagic[4]    = {'S', 'C', 'H', 'U'};
+static const char     kSummaryMagic[4] = {'S', 'C', 'H', 'S'};
+static const uint32_t kGridVersion     = 1;
+static const uint32_t kMaxGridMessage  = 64u << 20;
+static const uint32_t kMaxGridUnit     = 64u << 10; // a unit is a few paths and numbers
+static const int      kGridMaxConnections = 64;
+static const int      kGridConnectTries = 3;
+static const int      kGridConnectTimeoutMs = 5000;
+static const size_t   kGridCachedSets  = 4;
+
+struct WireWriter {
+    string buf;
+
+    void raw(const void *p, size_t k) { buf.append((const char*)p, k); }
+    void u8(uint8_t x)   { raw(&x, 1); }
+    void u32(uint32_t x) { raw(&x, 4); }
+    void i32(int32_t x)  { raw(&x, 4); }
+    void u64(uint64_t x) { raw(&x, 8); }
+    void i64(int64_t x)  { raw(&x, 8); }
+    void f64(double x)   { raw(&x, 8); }
+    void i128(__int128 x) { u64((uint64_t)x); u64((uint64_t)((unsigned __int128)x >> 64)); }
+    void str(const string &s) { u32((uint32_t)s.size()); raw(s.data(), s.size()); }
+};
+
+// Throws on a message that ends early
+struct WireReader {
+    const char *p, *end;
+
+    explicit WireReader(const string &msg) : p(msg.data()), end(msg.data() + msg.size()) {}
+    void raw(void *out, size_t k) {
+        if ((size_t)(end - p) < k) throw runtime_error("grid: truncated message");
+        memcpy(out, p, k); p += k;
+    }
+    template <class T> T get() { T x; raw(&x, sizeof x); return x; }
+    uint8_t u8()   { return get<uint8_t>(); }
+    uint32_t u32() { return get<uint32_t>(); }
+    int32_t i32()  { return get<int32_t>(); }
+    uint64_t u64() { return get<uint64_t>(); }
+    int64_t i64()  { return get<int64_t>(); }
+    double f64()   { return get<double>(); }
+    __int128 i128() {
+        uint64_t lo = u64(), hi = u64();
+        return (__int128)(((unsigned __int128)hi << 64) | lo);
+    }
+    string str() {
+        uint32_t k = u32();
+        if ((size_t)(end - p) < k) throw runtime_error("grid: truncated message");
+        string s(p, k); p += k;
+        return s;
+    }
+    void magic(const char m[4], const char *what) {
+        char got[4];
+        raw(got, 4);
+        if (memcmp(got, m, 4) != 0) throw runtime_error(string("grid: not a ") + what + " message");
+    }
+};
+
+// One cell of the grid. algo is a batch --algo name; quantum is ignored by
+// the policies without one, and cpus > 1 runs the SMP engine.
+struct GridUnit {
+    string trace, format, algo;
+    int quantum = 1, cpus = 1;
+    bool coalesce = false, steal = false, leastLoaded = false;
+    DispatchCost dc;
+    uint64_t seed = kLotterySeed;
+};
+
+static void encodeUnit(WireWriter &w, const GridUnit &u) {
+    w.raw(kUnitMagic, 4); w.u32(kGridVersion); w.u32(sizeof(SimTime));
+    w.str(u.trace); w.str(u.format); w.str(u.algo);
+    w.i32(u.quantum); w.i32(u.cpus);
+    w.u8((u.coalesce ? 1 : 0) | (u.steal ? 2 : 0) | (u.leastLoaded ? 4 : 0));
+    w.i64(u.dc.cost); w.i64(u.dc.warmup); w.u64(u.seed);
+}
+
+static GridUnit decodeUnit(const string &msg) {
+    WireReader r(msg);
+    r.magic(kUnitMagic, "work unit");
+    uint32_t version = r.u32(), width = r.u32();
+    if (version != kGridVersion) throw runtime_error("grid: unsupported unit version " + to_string(version));
+    if (width != sizeof(SimTime))
+        throw runtime_error("grid: coordinator uses " + to_string(8 * width) + "-bit times, this worker " +
+                            to_string(8 * sizeof(SimTime)) + "-bit (see SCHED_TIME64)");
+    GridUnit u;
+    u.trace = r.str(); u.format = r.str(); u.algo = r.str();
+    long long quantum = r.i32(), cpus = r.i32();
+    // The bounds parseBatchArgs puts on --quantum and --cpus
+    if (quantum < 1 || quantum > kMaxQuantum)
+        throw runtime_error("grid: quantum outside [1, " + to_string(kMaxQuantum) + "]");
+    if (cpus < 1 || cpus > kMaxCpus) throw runtime_error("grid: cpus outside [1, " + to_string(kMaxCpus) + "]");
+    u.quantum = (int)quantum; u.cpus = (int)cpus;
+    uint8_t flags = r.u8();
+    u.coalesce = flags & 1; u.steal = flags & 2; u.leastLoaded = flags & 4;
+    long long cost = r.i64(), warmup = r.i64();
+    if (cost < 0 || cost > kMaxBurst || warmup < 0 || warmup > kMaxBurst)
+        throw runtime_error("grid: switch cost outside [0, " + to_string(kMaxBurst) + "]");
+    u.dc.cost = (SimTime)cost; u.dc.warmup = (SimTime)warmup; u.seed = r.u64();
+    return u;
+}
+
+static void encodeSummary(WireWriter &w, const RunSummary &s) {
+    w.str(s.name);
+    w.i128(s.makespan); w.i128(s.switchTime);
+    s.stats.wait.encode(w); s.stats.tat.encode(w); s.stats.response.encode(w);
+    w.f64(s.stats.slowdownSum); w.f64(s.stats.slowdownSq);
+}
+
+static RunSummary decodeSummary(WireReader &r) {
+    RunSummary s;
+    s.name = r.str();
+    s.makespan = (TimeSum)r.i128(); s.switchTime = (TimeSum)r.i128();
+    s.stats.wait.decode(r); s.stats.tat.decode(r); s.stats.response.decode(r);
+    s.stats.slowdownSum = r.f64(); s.stats.slowdownSq = r.f64();
+    return s;
+}
+
+static bool gridUsesQuantum(const string &a) { return a == "rr" || a == "mlfq" || a == "lottery" || a == "stride"; }
+static bool gridRunsOnSmp(const string &a) { return a == "rr" || a == "sjf" || a == "priority"; }
+
+// Metrics-only run of one unit
+static RunSummary runGridUnit(const ProcessView &v, const GridUnit &u) {
+    const string &a = u.algo;
+    int q = u.quantum;
+    if (u.cpus > 1) {
+        SmpOptions so;
+        so.cpus = u.cpus; so.quantum = q; so.steal = u.steal; so.leastLoaded = u.leastLoaded;
+        if (a == "rr") so.policy = SmpPolicy::RoundRobin;
+        else if (a == "sjf") so.policy = SmpPolicy::SJF;
+        else if (a == "priority") so.policy = SmpPolicy::Priority;
+        else throw runtime_error("grid: --cpus does not support " + a);
+        return summarize(runSMP(v, so).metrics);
+    }
+    const DispatchCost &dc = u.dc;
+    checkDispatchBudget(v, dc, gridUsesQuantum(a) ? q : 0);
+    if (a == "fcfs")       return summarize(runFCFS<MetricsSink>(v, dc));
+    if (a == "sjf")        return summarize(runSJF<MetricsSink>(v, dc));
+    if (a == "priority")   return summarize(runPriorityNP<MetricsSink>(v, dc));
+    if (a == "rr")         return summarize(runRR<MetricsSink>(v, q, u.coalesce, dc));
+    if (a == "srtf")       return summarize(runSRTF<MetricsSink>(v, dc));
+    if (a == "priority-p") return summarize(runPriorityP<MetricsSink>(v, dc));
+    if (a == "mlfq")       return summarize(runMLFQ<MetricsSink>(v, defaultMlfq(q), dc));
+    if (a == "lottery")    return summarize(runLottery<MetricsSink>(v, q, u.seed, dc));
+    if (a == "stride")     return summarize(runStride<MetricsSink>(v, q, dc));
+    throw runtime_error("grid: unknown algorithm '" + a + "'");
+}
+
+// ---- Sockets ----
+
+class Socket {
+public:
+    explicit Socket(int fd = -1) : fd_(fd) {}
+    ~Socket() { if (fd_ >= 0) close(fd_); }
+    Socket(Socket &&o) noexcept : fd_(o.fd_) { o.fd_ = -1; }
+    Socket& operator=(Socket &&o) noexcept { swap(fd_, o.fd_); return *this; }
+    Socket(const Socket&) = delete;
+    Socket& operator=(const Socket&) = delete;
+
+    int fd() const { return fd_; }
+    explicit operator bool() const { return fd_ >= 0; }
+
+private:
+    int fd_;
+};
+
+static void sendAll(int fd, const char *p, size_t k) {
+    while (k > 0) {
+        ssize_t w = send(fd, p, k, MSG_NOSIGNAL);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) throw runtime_error(string("grid: send failed: ") + strerror(errno));
+        p += w; k -= (size_t)w;
+    }
+}
+
+// False on a clean end of stream before the first byte
+static bool recvAll(int fd, char *p, size_t k) {
+    size_t got = 0;
+    while (got < k) {
+        ssize_t r = recv(fd, p + got, k - got, 0);
+        if (r < 0 && errno == EINTR) continue;
+        if (r < 0) throw runtime_error(string("grid: receive failed: ") + strerror(errno));
+        if (r == 0) {
+            if (got == 0) return false;
+            throw runtime_error("grid: connection closed mid-message");
+        }
+        got += (size_t)r;
+    }
+    return true;
+}
+
+static void sendMessage(int fd, const string &payload) {
+    uint32_t len = (uint32_t)payload.size();
+    string frame((const char*)&len, 4);
+    frame += payload;
+    sendAll(fd, frame.data(), frame.size());
+}
+
+// False when the peer closed the connection between messages
+static bool recvMessage(int fd, string &payload, uint32_t limit = kMaxGridMessage) {
+    uint32_t len;
+    if (!recvAll(fd, (char*)&len, 4)) return false;
+    if (len > limit) throw runtime_error("grid: message of " + to_string(len) + " bytes");
+    payload.resize(len);
+    if (len > 0 && !recvAll(fd, &payload[0], len)) throw runtime_error("grid: connection closed mid-message");
+    return true;
+}
+
+static void tuneSocket(int fd) {
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+    setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &one, sizeof one);
+}
+
+// endpoint is host:port (an IPv6 host in brackets, [::1]:7000)
+static Socket connectTo(const string &endpoint) {
+    size_t colon = endpoint.rfind(':');
+    if (colon == string::npos || colon == 0 || colon + 1 == endpoint.size())
+        throw runtime_error("grid: worker '" + endpoint + "' is not host:port");
+    string host = endpoint.substr(0, colon), port = endpoint.substr(colon + 1);
+    if (host.size() > 2 && host.front() == '[' && host.back() == ']') host = host.substr(1, host.size() - 2);
+
+    addrinfo hints = {}, *res = nullptr;
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (int e = getaddrinfo(host.c_str(), port.c_str(), &hints, &res))
+        throw runtime_error("grid: cannot resolve '" + endpoint + "': " + gai_strerror(e));
+    unique_ptr<addrinfo, void(*)(addrinfo*)> list(res, freeaddrinfo);
+    string why = "no address";
+    for (addrinfo *a = res; a; a = a->ai_next) {
+        Socket s(socket(a->ai_family, a->ai_socktype | SOCK_NONBLOCK, a->ai_protocol));
+        if (!s) { why = strerror(errno); continue; }
+        // Non-blocking connect, so an unreachable host fails after the timeout
+        if (connect(s.fd(), a->ai_addr, a->ai_addrlen) != 0) {
+            if (errno != EINPROGRESS) { why = strerror(errno); continue; }
+            pollfd pfd = {s.fd(), POLLOUT, 0};
+            int err = 0; socklen_t len = sizeof err;
+            int ready = poll(&pfd, 1, kGridConnectTimeoutMs);
+            if (ready <= 0) { why = ready == 0 ? "timed out" : strerror(errno); continue; }
+            if (getsockopt(s.fd(), SOL_SOCKET, SO_ERROR, &err, &len) != 0 || err != 0) { why = strerror(err); continue; }
+        }
+        fcntl(s.fd(), F_SETFL, fcntl(s.fd(), F_GETFL) & ~O_NONBLOCK);
+        tuneSocket(s.fd());
+        return s;
+    }
+    throw runtime_error("grid: cannot connect to '" + endpoint + "': " + why);
+}
+
+// ---- Worker ----
+
+// Traces loaded by a worker, shared by its connections so that every unit
+// of one trace parses it once. Beyond kGridCachedSets the least recently
+// used set is dropped (still alive while a unit runs on it). The lock only
+// covers the lookup: the first connection to ask for a trace parses it
+// outside the lock while later ones wait on its shared future, so a cache
+// hit never waits behind another trace's load. A failed load is dropped
+// from the cache, so a retry parses the file again.
+class GridSetCache {
+public:
+    using Set = shared_ptr<const LoadedSet>;
+
+    Set get(const string &path, const string &format) {
+        string key = format + '\n' + path;
+        promise<Set> loading;
+        shared_future<Set> set;
+        bool mine = false;
+        {
+            lock_guard<mutex> lock(m_);
+            for (size_t k = 0; k < sets_.size(); ++k) {
+                if (sets_[k].first != key) continue;
+                rotate(sets_.begin() + k, sets_.begin() + k + 1, sets_.end()); // most recent last
+                set = sets_.back().second;
+                break;
+            }
+            if (!set.valid()) {
+                mine = true;
+                set = loading.get_future().share();
+                if (sets_.size() == kGridCachedSets) sets_.erase(sets_.begin());
+                sets_.push_back({key, set});
+            }
+        }
+        if (mine) {
+            try {
+                auto s = make_shared<LoadedSet>();
+                openProcessSet(path, format, *s);
+                loading.set_value(s);
+            } catch (...) {
+                loading.set_exception(current_exception());
+                lock_guard<mutex> lock(m_);
+                for (size_t k = 0; k < sets_.size(); ++k)
+                    if (sets_[k].first == key) { sets_.erase(sets_.begin() + k); break; }
+            }
+        }
+        return set.get();
+    }
+
+private:
+    mutex m_;
+    vector<pair<string, shared_future<Set>>> sets_;
+};
+
+// The path a unit may open. With a trace root it is the file's canonical
+// path, which must lie under the (canonical) root, so neither ".." nor a
+// symlink leads out of it; without one, the path as sent.
+static string allowedTrace(const string &path, const string &root) {
+    if (root.empty()) return path;
+    unique_ptr<char, void(*)(void*)> real(realpath(path.c_str(), nullptr), free);
+    if (!real) throw runtime_error("cannot open '" + path + "': " + strerror(errno));
+    string p = real.get();
+    bool inside = p.size() > root.size() && p.compare(0, root.size(), root) == 0 &&
+                  (root.back() == '/' || p[root.size()] == '/');
+    if (!inside) throw runtime_error("'" + path + "' is outside this worker's trace root");
+    return p;
+}
+
+// Answers units until the coordinator hangs up; a unit that fails gets an
+// error summary and the connection stays usable.
+static void serveGridConnection(Socket s, GridSetCache &cache, const string &root) {
+    string msg;
+    while (recvMessage(s.fd(), msg, kMaxGridUnit)) {
+        WireWriter w;
+        w.raw(kSummaryMagic, 4);
+        try {
+            GridUnit u = decodeUnit(msg);
+            shared_ptr<const LoadedSet> set = cache.get(allowedTrace(u.trace, root), u.format);
+            if (set->view.n == 0) throw runtime_error("trace '" + u.trace + "' contains no processes");
+            RunSummary sum = runGridUnit(set->view, u);
+            w.u8(0);
+            encodeSummary(w, sum);
+        } catch (const exception &e) {
+            w.buf.resize(4);
+            w.u8(1);
+            w.str(e.what());
+        }
+        sendMessage(s.fd(), w.buf);
+    }
+}
+
+static bool isLoopback(const sockaddr *a) {
+    if (a->sa_family == AF_INET) return (ntohl(((const sockaddr_in*)a)->sin_addr.s_addr) >> 24) == 127;
+    if (a->sa_family != AF_INET6) return false;
+    const in6_addr &x = ((const sockaddr_in6*)a)->sin6_addr;
+    return IN6_IS_ADDR_LOOPBACK(&x) || (IN6_IS_ADDR_V4MAPPED(&x) && x.s6_addr[12] == 127);
+}
+
+// Serves units on host:port (see the trust model above): host defaults to
+// loopback, and any other address needs a trace root.
+static int runGridWorker(int port, const string &bindHost, const string &traceRoot) {
+    string root;
+    if (!traceRoot.empty()) {
+        unique_ptr<char, void(*)(void*)> real(realpath(traceRoot.c_str(), nullptr), free);
+        struct stat sb;
+        if (!real || stat(real.get(), &sb) != 0 || !S_ISDIR(sb.st_mode))
+            throw runtime_error("grid: trace root '" + traceRoot + "' is not a directory");
+        root = real.get();
+    }
+    string host = bindHost.empty() ? "127.0.0.1" : bindHost;
+    if (host.size() > 2 && host.front() == '[' && host.back() == ']') host = host.substr(1, host.size() - 2);
+
+    addrinfo hints = {}, *res = nullptr;
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    string service = to_string(port);
+    if (int e = getaddrinfo(host.c_str(), service.c_str(), &hints, &res))
+        throw runtime_error("grid: cannot resolve bind address '" + host + "': " + gai_strerror(e));
+    unique_ptr<addrinfo, void(*)(addrinfo*)> list(res, freeaddrinfo);
+    Socket listener;
+    string why = "no address";
+    for (addrinfo *a = res; a && !listener; a = a->ai_next) {
+        if (!isLoopback(a->ai_addr) && root.empty())
+            throw runtime_error("grid: --bind " + host + " is not a loopback address; give --trace-root too");
+        Socket s(socket(a->ai_family, a->ai_socktype, a->ai_protocol));
+        if (!s) { why = strerror(errno); continue; }
+        int one = 1;
+        setsockopt(s.fd(), SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+        if (::bind(s.fd(), a->ai_addr, a->ai_addrlen) != 0 || listen(s.fd(), 64) != 0) { why = strerror(errno); continue; }
+        listener = move(s);
+    }
+    if (!listener) throw runtime_error("grid: cannot listen on " + host + " port " + to_string(port) + ": " + why);
+    cerr << "[Info] Grid worker listening on " << host << " port " << port << " (" << sizeof(SimTime) * 8
+         << "-bit times; " << (root.empty() ? string("traces: any path") : "traces under " + root) << ")\n";
+
+    // Owned jointly by the accept loop and every connection thread, so a
+    // detached thread never outlives what it uses
+    struct Shared {
+        GridSetCache cache;
+        string root;
+        atomic<int> connections{0};
+    };
+    auto shared = make_shared<Shared>();
+    shared->root = root;
+    while (true) {
+        int fd = accept(listener.fd(), nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) {
+                // Out of descriptors or buffers for now: wait for connections to close
+                cerr << "[Error] grid: accept failed: " << strerror(errno) << " (retrying)\n";
+                this_thread::sleep_for(chrono::milliseconds(200));
+                continue;
+            }
+            throw runtime_error(string("grid: accept failed: ") + strerror(errno));
+        }
+        if (shared->connections.load() >= kGridMaxConnections) {
+            close(fd);
+            cerr << "[Error] grid: " << kGridMaxConnections << " connections open; refused another\n";
+            continue;
+        }
+        tuneSocket(fd);
+        shared->connections++;
+        thread([fd, shared]{
+            try { serveGridConnection(Socket(fd), shared->cache, shared->root); }
+            catch (const exception &e) { cerr << "[Error] " << e.what() << "\n"; }
+            shared->connections--;
+        }).detach();
+    }
+}
+
+// ---- Coordinator ----
+
+struct GridSpec {
+    vector<string> traces, algos, workers; // algos: batch --algo names or "all"
+    string format;
+    vector<int> quanta = {1}, cpus = {1};
+    bool coalesce = false, steal = false, leastLoaded = false;
+    DispatchCost dc;
+    uint64_t seed = kLotterySeed;
+    int retries = 3;
+    RankMetric rank;
+};
+
+static const char *kGridAlgos[] = {"fcfs", "sjf", "priority", "rr", "srtf", "priority-p", "mlfq", "lottery", "stride"};
+
+
+// Work units grouped by configuration: config[c] holds the indexes of its
+// units, one per trace. Policies without a quantum get one configuration
+// rather than one per quantum, and only the SMP policies run with cpus > 1.
+static void expandGrid(const GridSpec &g, vector<GridUnit> &units, vector<vector<size_t>> &config) {
+    vector<string> algos;
+    for (const string &a : g.algos) {
+        if (a == "all") algos.insert(algos.end(), begin(kGridAlgos), end(kGridAlgos));
+        else algos.push_back(a);
+    }
+    for (int c : g.cpus)
+    for (const string &a : algos) {
+        if (c > 1 && !gridRunsOnSmp(a)) continue;
+        for (size_t qi = 0; qi < (gridUsesQuantum(a) ? g.quanta.size() : 1); ++qi) {
+            config.emplace_back();
+            for (const string &t : g.traces) {
+                GridUnit u;
+                u.trace = t; u.format = g.format; u.algo = a;
+                u.quantum = g.quanta[qi]; u.cpus = c;
+                u.coalesce = g.coalesce; u.steal = g.steal; u.leastLoaded = g.leastLoaded;
+                u.dc = g.dc; u.seed = g.seed;
+                config.back().push_back(units.size());
+                units.push_back(move(u));
+            }
+        }
+    }
+}
+
+// Runs every unit on the workers; returns false (after reporting) if a unit
+// ran out of retries or no worker could be reached.
+static bool runGridUnits(const GridSpec &g, const vector<GridUnit> &units, vector<RunSummary> &out) {
+    mutex m;
+    condition_variable cv;
+    deque<size_t> queue;
+    for (size_t k = 0; k < units.size(); ++k) queue.push_back(k);
+    vector<int> attempts(units.size(), 0);
+    size_t inFlight = 0, retried = 0, live = g.workers.size();
+    vector<string> failures;
+    out.assign(units.size(), RunSummary());
+
+    // Called with m held when a unit failed (counts) or could not be sent;
+    // returns whether it was queued again
+    auto failed = [&](size_t k, const string &why, bool counts) {
+        if (counts && ++attempts[k] > g.retries) {
+            failures.push_back(units[k].trace + " / " + units[k].algo + ": " + why);
+            return false;
+        }
+        if (counts) retried++;
+        queue.push_back(k);
+        return true;
+    };
+
+    auto drive = [&](const string &endpoint) {
+        Socket s;
+        int refused = 0;
+        while (true) {
+            size_t k;
+            {
+                unique_lock<mutex> lock(m);
+                cv.wait(lock, [&]{ return !queue.empty() || inFlight == 0; });
+                if (queue.empty()) return;
+                k = queue.front(); queue.pop_front();
+                inFlight++;
+            }
+            string why;
+            bool counts = true;
+            try {
+                if (!s) {
+                    try { s = connectTo(endpoint); refused = 0; }
+                    catch (...) { counts = false; throw; }
+                }
+                WireWriter w;
+                encodeUnit(w, units[k]);
+                sendMessage(s.fd(), w.buf);
+                string reply;
+                if (!recvMessage(s.fd(), reply)) throw runtime_error("grid: worker closed the connection");
+                WireReader r(reply);
+                r.magic(kSummaryMagic, "summary");
+                if (r.u8() == 0) {
+                    RunSummary sum = decodeSummary(r);
+                    lock_guard<mutex> lock(m);
+                    out[k] = move(sum);
+                    inFlight--;
+                    cv.notify_all();
+                    continue;
+                }
+                why = r.str(); // the worker is fine; the unit failed there
+            } catch (const exception &e) {
+                why = e.what();
+                s = Socket();
+            }
+            bool giveUp = !counts && ++refused >= kGridConnectTries;
+            {
+                lock_guard<mutex> lock(m);
+                bool again = failed(k, why, counts);
+                if (counts) cerr << "[Error] " << endpoint << ": " << why << (again ? " (retrying)" : "") << "\n";
+                inFlight--;
+                if (giveUp) {
+                    cerr << "[Error] " << why << "; giving up on " << endpoint << "\n";
+                    if (--live == 0)
+                        while (!queue.empty()) { failures.push_back("no worker left for " + units[queue.front()].trace); queue.pop_front(); }
+                }
+                cv.notify_all();
+            }
+            if (giveUp) return;
+            if (!counts) this_thread::sleep_for(chrono::milliseconds(200 * refused));
+        }
+    };
+
+    vector<thread> threads;
+    for (const string &e : g.workers) threads.emplace_back(drive, e);
+    for (auto &t : threads) t.join();
+
+    if (retried > 0) cerr << "[Info] " << retried << " unit" << (retried == 1 ? "" : "s") << " retried\n";
+    if (!failures.empty()) {
+        cerr << "[Error] " << failures.size() << " of " << units.size() << " units failed";
+        for (size_t k = 0; k < failures.size() && k < 5; ++k) cerr << "\n        " << failures[k];
+        cerr << "\n";
+        return false;
+    }
+    return true;
+}
+
+static bool runGrid(const GridSpec &g) {
+    vector<GridUnit> units;
+    vector<vector<size_t>> config;
+    expandGrid(g, units, config);
+    if (units.empty()) throw runtime_error("grid: nothing to run");
+
+    auto t0 = chrono::steady_clock::now();
+    vector<RunSummary> results;
+    if (!runGridUnits(g, units, results)) return false;
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+
+    // Pool each configuration over the traces, in trace order
+    vector<RunSummary> rows;
+    for (const auto &c : config) {
+        RunSummary row = results[c.front()];
+        for (size_t k = 1; k < c.size(); ++k) row.merge(results[c[k]]);
+        rows.push_back(move(row));
+    }
+    cout << "\n[Info] " << units.size() << " units (" << config.size() << " configurations x "
+         << g.traces.size() << " trace" << (g.traces.size() == 1 ? "" : "s") << ", "
+         << rows.front().stats.wait.count() << " processes per configuration) on " << g.workers.size() << " worker connection"
+         << (g.workers.size() == 1 ? "" : "s") << " in " << fixed << setprecision(2) << secs << " s\n";
+    printComparison(rows, g.rank, g.dc);
+    return true;
+}
+
+#ifndef SCHEDULER_NO_MAIN // scheduler_bench.cpp includes this file for the engines only
+
+// ---------- Result inspection ----------
+// Menu option 18 (and batch --inspect, for traces too large for the menu)
+// keeps the last single-CPU run and lets the user look at
+// parts of it: one page of the per-process table, the Gantt chart of a time
+// window, or the segments of one PID. Each view costs what it shows. A
+// single-CPU timeline is contiguous and in time order, so a window starts at
+// a binary search over segment ends; the per-PID index (CSR: segment numbers
+// grouped by PID) is built by one counting pass on the first PID lookup and
+// kept until the next run.
+
+static const size_t kInspectPageRows = 20;
+static const size_t kInspectMaxSegments = 64; // per PID lookup
+
+class ResultInspector {
+public:
+    // Takes over a printed run (recycling the previous one's timeline).
+    void keep(Result&& r) {
+        drop();
+        res_ = move(r);
+    }
+    void drop() {
+        if (has()) recycleTimeline(move(res_));
+        res_ = Result();
+        pidStart_.clear(); pidSegs_.clear();
+    }
+    bool has() const { return !res_.completion.empty(); }
+    const Result& result() const { return res_; }
+    size_t processes() const { return has() ? res_.completion.size() - 1 : 0; }
+    size_t pages() const { return (processes() + kInspectPageRows - 1) / kInspectPageRows; }
+    SimTime makespan() const { return res_.timeline.empty() ? 0 : res_.timeline.back().end; }
+
+    // Page 1..pages() of the per-process table.
+    void printPage(const ProcessView& v, size_t page) const {
+        size_t first = (page - 1) * kInspectPageRows + 1, last = min(processes(), page * kInspectPageRows);
+        cout << "\nPer-Process Metrics, page " << page << " of " << pages() << " (P" << first << "..P" << last << "):\n";
+        printMetricsHeader();
+        printMetricRows(res_, v, first, last);
+    }
+
+    // Gantt chart of [from, to), segments clipped to the window.
+    void drawWindow(SimTime from, SimTime to) const {
+        const vector<Segment> &tl = res_.timeline;
+        auto it = partition_point(tl.begin(), tl.end(), [&](const Segment &s) { return s.end <= from; });
+        vector<Segment> window;
+        for (; it != tl.end() && it->start < to; ++it)
+            window.push_back({it->pid, max(it->start, from), min(it->end, to)});
+        cout << "\n[Info] " << window.size() << " of " << tl.size() << " segments fall in [" << from << ", " << to << ").\n";
+        drawGantt(window, from);
+    }
+
+    void printPid(const ProcessView& v, int pid) {
+        if (pidStart_.empty()) buildPidIndex();
+        const Result &r = res_;
+        cout << "\nP" << pid << ": arrival " << v.arrival[pid-1] << ", burst " << v.burst[pid-1]
+             << ", priority " << v.priority[pid-1] << "; completes at " << r.completion[pid]
+             << " (turnaround " << r.tat[pid] << ", waiting " << r.waiting[pid] << ", response " << r.response[pid] << ")\n";
+        size_t b = pidStart_[pid], e = pidStart_[pid+1];
+        cout << "Ran in " << e - b << " segment" << (e - b == 1 ? "" : "s") << ":";
+        for (size_t k = b; k < e && k - b < kInspectMaxSegments; ++k) {
+            const Segment &s = r.timeline[pidSegs_[k]];
+            cout << ((k - b) % 8 == 0 ? "\n " : "") << " [" << s.start << ", " << s.end << ")";
+        }
+        if (e - b > kInspectMaxSegments) cout << "\n  ... and " << e - b - kInspectMaxSegments << " more";
+        cout << "\n";
+    }
+
+private:
+    void buildPidIndex() {
+        const vector<Segment> &tl = res_.timeline;
+        size_t n = processes();
+        pidStart_.assign(n + 2, 0);
+        for (const Segment &s : tl)
+            if (s.pid > 0) ++pidStart_[s.pid + 1];
+        for (size_t p = 1; p <= n + 1; ++p) pidStart_[p] += pidStart_[p-1];
+        pidSegs_.resize(pidStart_[n+1]);
+        vector<size_t> fill(pidStart_.begin(), pidStart_.end() - 1);
+        for (size_t k = 0; k < tl.size(); ++k)
+            if (tl[k].pid > 0) pidSegs_[fill[tl[k].pid]++] = k;
+    }
+
+    Result res_;
+    vector<size_t> pidStart_; // PID p's segments are pidSegs_[pidStart_[p] .. pidStart_[p+1])
+    vector<size_t> pidSegs_;  // timeline indices, in time order per PID
+};
+
+// The option 18 submenu; the page and PID prompts repeat until 0.
+static void inspectResult(ResultInspector& in, const ProcessView& v) {
+    const Result &r = in.result();
+    while (true) {
+        cout << "\nInspect " << r.algo_name << " (" << in.processes() << " processes, " << r.timeline.size()
+             << " segments, makespan " << in.makespan() << "):\n";
+        cout << " 1) Page through the per-process table\n";
+        cout << " 2) Gantt chart of a time window\n";
+        cout << " 3) Segments of one PID\n";
+        cout << " 0) Back\n";
+        int choice = readInt("Choose an option: ", 0, 3);
+        if (choice == 0) return;
+        if (choice == 1) {
+            size_t page;
+            while ((page = (size_t)readNumber("Page (1.." + to_string(in.pages()) + ", 0 = back): ", 0, in.pages())) != 0)
+                in.printPage(v, page);
+        } else if (choice == 2) {
+            if (in.makespan() == 0) { cout << "\n[Info] The timeline is empty.\n"; continue; }
+            SimTime from = readTime("Window start (0.." + to_string((long long)in.makespan() - 1) + "): ", 0, in.makespan() - 1);
+            SimTime to = readTime("Window end (" + to_string((long long)from + 1) + ".." + to_string(in.makespan()) + "): ",
+                                  (long long)from + 1, in.makespan());
+            in.drawWindow(from, to);
+        } else {
+            int pid;
+            while ((pid = readInt("PID (1.." + to_string(in.processes()) + ", 0 = back): ", 0, in.processes())) != 0)
+                in.printPid(v, pid);
+        }
+    }
+}
+
+// ---------- Main menu ----------
+
+static const char *kRankHelp =
+    "avg|p50|p90|p99|p99.9|max|stddev + -wait|-tat|-response, or fairness";
+
+static RankMetric readRankMetric() {
+    while (true) {
+        cout << "Rank by (" << kRankHelp << ") [avg-wait]: ";
+        string s; getline(cin, s);
+        RankMetric m;
+        if (s.empty() || parseRankMetric(s, m)) return m;
+        cout << "Unknown metric '" << s << "'.\n";
+    }
+}
+
+static void runMenu() {
+    vector<Process> processes;
+    ProcessColumns cols; // columns of `processes`, patched in place on edits
+    DispatchCost dc;     // option 15; applies to every single-CPU run
+    ResultInspector last; // option 18; the last single-CPU run, until the set changes
+
+    // Incremental runs for the menu's FCFS/SJF/Priority/RR options
+    IncrementalRun fcfsRun(ReplayEngine::FCFS), sjfRun(ReplayEngine::SJF), prioRun(ReplayEngine::PriorityNP);
+    IncrementalRun rrRun(ReplayEngine::RoundRobin);
+    IncrementalRun *runs[] = {&fcfsRun, &sjfRun, &prioRun, &rrRun};
+    auto replaced = [&]() {
+        makeColumns(processes, cols);
+        for (IncrementalRun *run : runs) run->reset();
+        last.drop();
+    };
+    // A run charging dc must still fit SimTime; quantum: the smallest one it
+    // slices with, 0 for none
+    auto fits = [&](int quantum) {
+        TimeSum charges = dispatchCharges(cols.view(), dc, quantum);
+        TimeBudget budget = timeBudget(cols.view());
+        if (budget.fits(charges)) return true;
+        cout << "\n[Error] " << budget.error(charges) << ". Lower the context-switch cost (option 15).\n";
+        return false;
+    };
+    auto runAndPrint = [&](IncrementalRun &run) {
+        if (!fits(&run == &rrRun ? run.quantum() : 0)) return;
+        Result r = run.run(cols.view());
+        printResult(r, cols.view());
+        if (run.reused() > 0)
+            cout << "[Info] Replayed from t=" << run.resumedAt() << ", reusing " << run.reused()
+                 << " of " << r.timeline.size() << " segments from the previous run.\n";
+        last.keep(move(r));
+    };
+
+    cout << "\nCPU Scheduling Algorithm Simulator and Evaluator\n";
+    cout << "------------------------------------------------\n";
+
+    if (readYesNo("Load a demo dataset to get started?", true)) {
+        processes = demoDataset();
+        replaced();
+        printProcessTable(processes);
+    }
+
+    while (true) {
+        cout << "\nMenu:\n";
+        cout << " 1) Enter / Replace processes\n";
+        cout << " 2) Show current processes\n";
+        cout << " 3) Run FCFS\n";
+        cout << " 4) Run SJF (Non-Preemptive)\n";
+        cout << " 5) Run Round Robin\n";
+        cout << " 6) Run Priority (Non-Preemptive)\n";
+        cout << " 7) Compare All (with RR quantum)\n";
+        cout << " 8) Sweep Round Robin quantum range\n";
+        cout << " 9) Run SRTF (Preemptive SJF)\n";
+        cout << "10) Run Priority (Preemptive)\n";
+        cout << "11) Run multi-CPU (SMP) simulation\n";
+        cout << "12) Run Multilevel Feedback Queue\n";
+        cout << "13) Edit one process\n";
+        cout << "14) Monte Carlo evaluation over random workloads\n";
+        cout << "15) Set context-switch cost";
+        if (!dc.none()) cout << " (now " << dc.cost << " + warmup " << dc.warmup << ")";
+        cout << "\n";
+        cout << "16) Run Lottery scheduling (tickets from priority)\n";
+        cout << "17) Run Stride scheduling (tickets from priority)\n";
+        cout << "18) Inspect the last run (table pages, Gantt window, one PID)\n";
+        cout << " 0) Exit\n";
+
+        int choice = readInt("Choose an option: ", 0, 18);
+        if (choice == 0) {
+            cout << "Goodbye!\n"; break;
+        }
+
+        switch (choice) {
+            case 1: {
+                processes = enterProcesses();
+                replaced();
+                cout << "\n[Success] Process list updated.\n";
+                break;
+            }
+            case 2: {
+                if (processes.empty()) cout << "\n[Info] No processes loaded.\n";
+                else printProcessTable(processes);
+                break;
+            }
+            case 3: {
+                if (processes.empty()) { cout << "\n[Info] No processes loaded.\n"; break; }
+                runAndPrint(fcfsRun);
+                break;
+            }
+            case 4: {
+                if (processes.empty()) { cout << "\n[Info] No processes loaded.\n"; break; }
+                runAndPrint(sjfRun);
+                break;
+            }
+            case 5: {
+                if (processes.empty()) { cout << "\n[Info] No processes loaded.\n"; break; }
+                int q = readInt("Enter time quantum (>0): ", 1, kMaxQuantum);
+                bool merge = readYesNo("Merge back-to-back slices of a lone runnable process?", false);
+                // Checkpoints only carry over between runs with the same settings
+                if (q != rrRun.quantum() || merge != rrRun.coalesce()) rrRun = IncrementalRun(ReplayEngine::RoundRobin, q, merge, dc);
+                runAndPrint(rrRun);
+                break;
+            }
+            case 6: {
+                if (processes.empty()) { cout << "\n[Info] No processes loaded.\n"; break; }
+                runAndPrint(prioRun);
+                break;
+            }
+            case 7: {
+                if (processes.empty()) { cout << "\n[Info] No processes to compare. Please enter data first.\n"; break; }
+                int q = readInt("Enter time quantum for Round Robin (>0): ", 1, kMaxQuantum);
+                if (!fits(q)) break;
+                compareAlgorithms(cols.view(), q, readRankMetric(), dc);
+                break;
+            }
+            case 8: {
+                if (processes.empty()) { cout << "\n[Info] No processes loaded.\n"; break; }
+                int lo = readInt("Smallest quantum (>0): ", 1, kMaxQuantum);
+                int hi = readInt("Largest quantum: ", lo, min<long long>(kMaxQuantum, lo + 99'999));
+                vector<int> quanta;
+                for (int q = lo; q <= hi; ++q) quanta.push_back(q);
+                if (!fits(lo)) break;
+                sweepQuanta(cols.view(), quanta, false, dc);
+                break;
+            }
+            case 9: {
+                if (processes.empty()) { cout << "\n[Info] No processes loaded.\n"; break; }
+                if (!fits(0)) break;
+                Result r = runSRTF(cols.view(), dc);
+                printResult(r, cols.view());
+                last.keep(move(r));
+                break;
+            }
+            case 10: {
+                if (processes.empty()) { cout << "\n[Info] No processes loaded.\n"; break; }
+                if (!fits(0)) break;
+                Result r = runPriorityP(cols.view(), dc);
+                printResult(r, cols.view());
+                last.keep(move(r));
+                break;
+            }
+            case 11: {
+                if (processes.empty()) { cout << "\n[Info] No processes loaded.\n"; break; }
+                SmpOptions o;
+                o.cpus = readInt("Number of CPUs (1..1024): ", 1, 1024);
+                int pol = readInt("Per-CPU policy (1 = Round Robin, 2 = SJF, 3 = Priority): ", 1, 3);
+                o.policy = pol == 1 ? SmpPolicy::RoundRobin : pol == 2 ? SmpPolicy::SJF : SmpPolicy::Priority;
+                if (o.policy == SmpPolicy::RoundRobin) o.quantum = readInt("Enter time quantum (>0): ", 1, kMaxQuantum);
+                o.leastLoaded = readYesNo("Place arrivals on the least loaded CPU?", true);
+                o.steal = readYesNo("Let idle CPUs steal work?", true);
+                printSmpResult(runSMP(cols.view(), o), cols.view());
+                break;
+            }
+            case 12: {
+                if (processes.empty()) { cout << "\n[Info] No processes loaded.\n"; break; }
+                MlfqOptions o;
+                int levels = readInt("Number of levels (1.." + to_string(kMaxMlfqLevels) + "): ", 1, kMaxMlfqLevels);
+                o.quanta.assign(levels, 1);
+                for (int l = 0; l < levels; ++l)
+                    o.quanta[l] = readInt("Time quantum for level " + to_string(l) + " (>0): ", 1, kMaxQuantum);
+                o.boost = readInt("Priority boost period (0 = never): ", 0, 1'000'000'000);
+                if (!fits(*min_element(o.quanta.begin(), o.quanta.end()))) break;
+                Result r = runMLFQ(cols.view(), o, dc);
+                printResult(r, cols.view());
+                last.keep(move(r));
+                break;
+            }
+            case 13: {
+                if (processes.empty()) { cout << "\n[Info] No processes loaded.\n"; break; }
+                SimTime since;
+                const Process &p = editProcess(processes, since);
+                updateRow(cols, p);
+                for (IncrementalRun *run : runs) run->invalidate(since);
+                last.drop();
+                cout << "\n[Success] P" << p.pid << " updated; options 3-6 replay from their last checkpoint before t="
+                     << since << ".\n";
+                break;
+            }
+            case 14: {
+                // Workloads are drawn like the current set, or like the demo set if none is loaded
+                MonteCarloSpec mc;
+                mc.workload = fitWorkload(processes.empty() ? makeColumns(demoDataset()).view() : cols.view());
+                mc.workloads = readInt("Number of random workloads (1.." + to_string(kMaxMcWorkloads) + "): ", 1, kMaxMcWorkloads);
+                mc.quantum = readInt("Enter time quantum for Round Robin (>0): ", 1, kMaxQuantum);
+                mc.seed = (uint64_t)readNumber("Random seed: ", 0, LLONG_MAX);
+                monteCarlo(mc);
+                break;
+            }
+            case 15: {
+                dc.cost = readTime("Context switch cost (0 = free dispatch): ", 0, kMaxBurst);
+                dc.warmup = readTime("Extra cache warmup when switching to a different process: ", 0, kMaxBurst);
+                fcfsRun = IncrementalRun(ReplayEngine::FCFS, 1, false, dc);
+                sjfRun = IncrementalRun(ReplayEngine::SJF, 1, false, dc);
+                prioRun = IncrementalRun(ReplayEngine::PriorityNP, 1, false, dc);
+                rrRun = IncrementalRun(ReplayEngine::RoundRobin, rrRun.quantum(), rrRun.coalesce(), dc);
+                cout << "\n[Success] " << (dc.none() ? "Dispatch is free again.\n" : "Runs now charge context switches.\n");
+                break;
+            }
+            case 16:
+            case 17: {
+                if (processes.empty()) { cout << "\n[Info] No processes loaded.\n"; break; }
+                int q = readInt("Enter time quantum (>0): ", 1, kMaxQuantum);
+                if (!fits(q)) break;
+                Result r = choice == 16
+                    ? runLottery(cols.view(), q, (uint64_t)readNumber("Random seed: ", 0, LLONG_MAX), dc)
+                    : runStride(cols.view(), q, dc);
+                printResult(r, cols.view());
+                last.keep(move(r));
+                break;
+            }
+            case 18: {
+                if (!last.has()) { cout << "\n[Info] Run a single-CPU algorithm first (options 3-6, 9, 10, 12, 16, 17).\n"; break; }
+                inspectResult(last, cols.view());
+                break;
+            }
+        }
+    }
 }
 
-static void printResult(const Result &res, const vector<Process>& ps) {
-    cout << "\n=== " << res.algo_name << " Result ===\n";
-    drawGantt(res.timeline);
-
-    cout << "\nPer-Process Metrics:\n";
-    cout << left << setw(6) << "PID" << setw(10) << "Arrival" << setw(8) << "Burst" 
-         << setw(11) << "Complete" << setw(12) << "Turnaround" << setw(9) << "Waiting" << "\n";
-    cout << string(56, '-') << "\n";
-
-    // For stable lookup by PID
-    vector<Process> byPid(ps.size()+1);
-    for (auto &p : ps) byPid[p.pid] = p;
-
-    for (size_t pid = 1; pid < res.completion.size(); ++pid) {
-        if (byPid[pid].pid == 0) continue; // skip if not present
-        cout << left << setw(6) << pid
-             << setw(10) << byPid[pid].arrival
-             << setw(8)  << byPid[pid].burst
-             << setw(11) << res.completion[pid]
-             << setw(12) << res.tat[pid]
-             << setw(9)  << res.waiting[pid] << "\n";
-    }
-
-    cout << fixed << setprecision(2);
-    cout << "\nAverage Waiting Time   : " << res.avg_wait << "\n";
-    cout << "Average Turnaround Time: " << res.avg_tat << "\n\n";
-}
+// ---------- Differential check ----------
+// The engines above replaced straightforward implementations: SJF and
+// Priority rescanned every process per dispatch, RR copied its queue after
+// every slice. Those are kept here as the reference, ported to SimTime and
+// otherwise unchanged. Batch --verify K draws K random sets: all arrivals at
+// zero, bursts of equal arrivals, or sparse arrivals with idle gaps; small
+// burst and priority ranges for ties; PIDs shuffled against arrival order.
+// Every optimized path must then reproduce the reference segment for segment
+// and metric for metric: the three sinks, SimulationContext, an
+// IncrementalRun rerun after an edit, OnlineScheduler and the SMP engine on
+// one CPU. The first mismatch is shrunk to a minimal failing set and printed
+// as a trace. The table puts each path's time next to the reference's.
 
-// ---------- Metrics ----------
-static Result finalizeMetrics(const string& name, const vector<Process>& ps, const vector<Segment>& tl) {
+static Result refMetrics(const string& name, const vector<Process>& ps, const vector<Segment>& tl) {
     int n = (int)ps.size();
     Result r; r.algo_name = name; r.timeline = tl;
     r.completion.assign(n+1, 0);
@@ -190,9 +5342,9 @@ static Result finalizeMetrics(const string& name, const vector<Process>& ps, con
     double sumWait = 0.0, sumTat = 0.0;
     for (int pid = 1; pid <= n; ++pid) {
         const auto &p = byPid[pid];
-        int comp = r.completion[pid];
-        int tat = comp - p.arrival;
-        int wait = tat - p.burst;
+        SimTime comp = r.completion[pid];
+        SimTime tat = comp - p.arrival;
+        SimTime wait = tat - p.burst;
         if (tat < 0) tat = 0; // safety
         if (wait < 0) wait = 0; // safety for malformed inputs
         r.tat[pid] = tat;
@@ -207,9 +5359,7 @@ static Result finalizeMetrics(const string& name, const vector<Process>& ps, con
     return r;
 }
 
-// ---------- Algorithms ----------
-
-static Result runFCFS(const vector<Process>& ps) {
+static Result refFCFS(const vector<Process>& ps) {
     vector<Process> a = ps;
     sort(a.begin(), a.end(), [](const Process& x, const Process& y){
         if (x.arrival != y.arrival) return x.arrival < y.arrival;
@@ -217,7 +5367,7 @@ static Result runFCFS(const vector<Process>& ps) {
     });
 
     vector<Segment> tl;
-    int t = 0;
+    SimTime t = 0;
     for (const auto &p : a) {
         if (t < p.arrival) { // idle gap
             tl.push_back({-1, t, p.arrival});
@@ -226,36 +5376,31 @@ static Result runFCFS(const vector<Process>& ps) {
         tl.push_back({p.pid, t, t + p.burst});
         t += p.burst;
     }
-    return finalizeMetrics("FCFS", ps, tl);
+    return refMetrics("FCFS", ps, tl);
 }
 
-static Result runSJF(const vector<Process>& ps) {
+// SJF and Priority differ only in the key: scan for the ready process with
+// the smallest (key, arrival, pid), or idle until the next arrival.
+template <class Key>
+static Result refKeyed(const string& name, const vector<Process>& ps, Key key) {
     int n = (int)ps.size();
-    vector<Process> a = ps;
-
-    // Remaining set of unscheduled processes
     vector<bool> done(n+1, false);
-    int finished = 0;
-    int t = 0;
-    vector<Segment> tl;
+    int finished = 0; SimTime t = 0; vector<Segment> tl;
 
-    // Pre-sort by arrival, then burst, then pid for stable tie-breaking
     vector<Process> sorted = ps;
-    sort(sorted.begin(), sorted.end(), [](const Process& x, const Process& y){
+    sort(sorted.begin(), sorted.end(), [&](const Process& x, const Process& y){
         if (x.arrival != y.arrival) return x.arrival < y.arrival;
-        if (x.burst   != y.burst)   return x.burst   < y.burst;
+        if (key(x) != key(y)) return key(x) < key(y);
         return x.pid < y.pid;
     });
 
     while (finished < n) {
-        // Collect ready
         vector<Process> ready;
         for (const auto &p : sorted)
             if (!done[p.pid] && p.arrival <= t) ready.push_back(p);
 
         if (ready.empty()) {
-            // jump to next arrival
-            int next_arr = INT_MAX; const Process* nxt = nullptr;
+            SimTime next_arr = kTimeMax; const Process* nxt = nullptr;
             for (const auto &p : sorted) if (!done[p.pid]) {
                 if (p.arrival < next_arr) { next_arr = p.arrival; nxt = &p; }
             }
@@ -263,12 +5408,11 @@ static Result runSJF(const vector<Process>& ps) {
                 tl.push_back({-1, t, nxt->arrival});
                 t = nxt->arrival;
             }
-            continue; // re-evaluate ready set
+            continue;
         }
 
-        // Choose shortest job among ready
-        auto best = min_element(ready.begin(), ready.end(), [](const Process& x, const Process& y){
-            if (x.burst != y.burst) return x.burst < y.burst;
+        auto best = min_element(ready.begin(), ready.end(), [&](const Process& x, const Process& y){
+            if (key(x) != key(y)) return key(x) < key(y);
             if (x.arrival != y.arrival) return x.arrival < y.arrival;
             return x.pid < y.pid;
         });
@@ -277,52 +5421,18 @@ static Result runSJF(const vector<Process>& ps) {
         done[best->pid] = true;
         finished++;
     }
-    return finalizeMetrics("SJF (Non-Preemptive)", ps, tl);
+    return refMetrics(name, ps, tl);
 }
 
-static Result runPriorityNP(const vector<Process>& ps) {
-    int n = (int)ps.size();
-    vector<bool> done(n+1, false);
-    int finished = 0; int t = 0; vector<Segment> tl;
-
-    vector<Process> sorted = ps;
-    sort(sorted.begin(), sorted.end(), [](const Process& x, const Process& y){
-        if (x.arrival != y.arrival) return x.arrival < y.arrival;
-        if (x.priority != y.priority) return x.priority < y.priority; // smaller is higher
-        return x.pid < y.pid;
-    });
-
-    while (finished < n) {
-        vector<Process> ready;
-        for (const auto &p : sorted)
-            if (!done[p.pid] && p.arrival <= t) ready.push_back(p);
-
-        if (ready.empty()) {
-            int next_arr = INT_MAX; const Process* nxt = nullptr;
-            for (const auto &p : sorted) if (!done[p.pid]) {
-                if (p.arrival < next_arr) { next_arr = p.arrival; nxt = &p; }
-            }
-            if (nxt && t < nxt->arrival) {
-                tl.push_back({-1, t, nxt->arrival});
-                t = nxt->arrival;
-            }
-            continue;
-        }
+static Result refSJF(const vector<Process>& ps) {
+    return refKeyed("SJF (Non-Preemptive)", ps, [](const Process& p){ return (long long)p.burst; });
+}
 
-        auto best = min_element(ready.begin(), ready.end(), [](const Process& x, const Process& y){
-            if (x.priority != y.priority) return x.priority < y.priority; // smaller = higher
-            if (x.arrival  != y.arrival)  return x.arrival  < y.arrival;
-            return x.pid < y.pid;
-        });
-        tl.push_back({best->pid, t, t + best->burst});
-        t += best->burst;
-        done[best->pid] = true;
-        finished++;
-    }
-    return finalizeMetrics("Priority (Non-Preemptive)", ps, tl);
+static Result refPriorityNP(const vector<Process>& ps) {
+    return refKeyed("Priority (Non-Preemptive)", ps, [](const Process& p){ return (long long)p.priority; });
 }
 
-static Result runRR(const vector<Process>& ps, int quantum) {
+static Result refRR(const vector<Process>& ps, int quantum) {
     if (quantum <= 0) quantum = 1; // safeguard
     int n = (int)ps.size();
 
@@ -332,15 +5442,15 @@ static Result runRR(const vector<Process>& ps, int quantum) {
         return x.pid < y.pid;
     });
 
-    vector<int> rem(n+1, 0);
+    vector<SimTime> rem(n+1, 0);
     for (auto &p : ps) rem[p.pid] = p.burst;
 
     vector<Segment> tl;
     queue<int> q; // PID queue
 
-    int time = 0; size_t i = 0; int finished = 0;
+    SimTime time = 0; size_t i = 0; int finished = 0;
 
-    auto enqueueArrivals = [&](int upTo) {
+    auto enqueueArrivals = [&](SimTime upTo) {
         while (i < a.size() && a[i].arrival <= upTo) {
             q.push(a[i].pid); i++;
         }
@@ -356,7 +5466,6 @@ static Result runRR(const vector<Process>& ps, int quantum) {
     }
 
     vector<bool> inQueue(n+1, false);
-    // We've already pushed arrivals at time 0..time
     {
         queue<int> tmp = q; while (!tmp.empty()) { inQueue[tmp.front()] = true; tmp.pop(); }
     }
@@ -370,7 +5479,6 @@ static Result runRR(const vector<Process>& ps, int quantum) {
                     time = a[i].arrival;
                 }
                 enqueueArrivals(time);
-                // refresh inQueue flags
                 queue<int> tmp = q; inQueue.assign(n+1, false);
                 while (!tmp.empty()) { inQueue[tmp.front()] = true; tmp.pop(); }
                 continue;
@@ -382,172 +5490,881 @@ static Result runRR(const vector<Process>& ps, int quantum) {
         int pid = q.front(); q.pop(); inQueue[pid] = false;
         if (rem[pid] == 0) continue; // already done (safety)
 
-        int exec = min(quantum, rem[pid]);
+        SimTime exec = min<SimTime>(quantum, rem[pid]);
         tl.push_back({pid, time, time + exec});
         time += exec;
         rem[pid] -= exec;
 
         // Enqueue any new arrivals up to 'time'
         enqueueArrivals(time);
-        // Mark new inQueue flags
         queue<int> tmp = q; inQueue.assign(n+1, false);
         while (!tmp.empty()) { inQueue[tmp.front()] = true; tmp.pop(); }
 
         if (rem[pid] > 0) {
-            // Put it back to the end of the queue
             q.push(pid); inQueue[pid] = true;
         } else {
             finished++;
         }
     }
 
-    return finalizeMetrics("Round Robin (q=" + to_string(quantum) + ")", ps, tl);
+    return refMetrics("Round Robin (q=" + to_string(quantum) + ")", ps, tl);
 }
 
-// ---------- Data entry ----------
+static Result reference(ReplayEngine e, const vector<Process>& ps, int q) {
+    switch (e) {
+        case ReplayEngine::FCFS:       return refFCFS(ps);
+        case ReplayEngine::SJF:        return refSJF(ps);
+        case ReplayEngine::PriorityNP: return refPriorityNP(ps);
+        default:                       return refRR(ps, q);
+    }
+}
 
-static vector<Process> enterProcesses() {
-    int n = readInt("Enter number of processes (1..100): ", 1, 100);
-    vector<Process> ps; ps.reserve(n);
+enum class VerifyPath { Timeline, Compact, Metrics, Context, Incremental, Online, Smp };
 
-    bool autoPID = true; // we assign PIDs as 1..n in order
+static const int kVerifyEngines = 4, kVerifyPaths = 7;
+static const char *kVerifyEngineNames[kVerifyEngines] = {"FCFS", "SJF", "Priority", "RR"};
+static const char *kVerifyPathNames[kVerifyPaths] = {
+    "TimelineSink", "CompactTimelineSink", "MetricsSink", "SimulationContext",
+    "IncrementalRun", "OnlineScheduler", "SMP, 1 CPU"};
+static const size_t kVerifyMaxShown = 64; // segments of a shrunk failure
 
-    for (int i = 1; i <= n; ++i) {
-        cout << "\n--- Enter data for Process P" << i << " ---\n";
-        int arr = readInt("Arrival time (>=0): ", 0, 1'000'000);
-        int burst = readInt("Burst time (>0): ", 1, 1'000'000);
-        int prio = readInt("Priority (integer; smaller = higher): ", INT_MIN/2, INT_MAX/2);
-        ps.push_back({i, arr, burst, prio});
+struct VerifySpec {
+    size_t sets = 1000;
+    size_t maxProcesses = 64; // set sizes are drawn from 1..maxProcesses
+    int quantum = 0;          // 0: drawn per set from 1..8
+    uint64_t seed = 1;
+};
+
+// The SMP engine has no FCFS policy
+static bool verifyApplies(ReplayEngine e, VerifyPath p) { return p != VerifyPath::Smp || e != ReplayEngine::FCFS; }
+
+// The edit an IncrementalRun is rerun after: a mid-set process (in PID
+// order) arrives one tick later with a different burst.
+static vector<Process> verifyEdit(const vector<Process>& ps, Process &edited) {
+    vector<Process> out = ps;
+    auto &p = *find_if(out.begin(), out.end(), [&](const Process& x){ return x.pid == (int)(ps.size() + 1) / 2; });
+    p.arrival += 1;
+    p.burst = p.burst % 7 + 1;
+    edited = p;
+    return out;
+}
+
+// The set path p is checked on: for IncrementalRun, the edited one
+static vector<Process> verifyInput(VerifyPath p, const vector<Process>& ps) {
+    Process edited;
+    return p == VerifyPath::Incremental ? verifyEdit(ps, edited) : ps;
+}
+
+template <class Sink>
+static Result runVerifySink(ReplayEngine e, const ProcessView& v, int q) {
+    switch (e) {
+        case ReplayEngine::FCFS:       return runFCFS<Sink>(v);
+        case ReplayEngine::SJF:        return runSJF<Sink>(v);
+        case ReplayEngine::PriorityNP: return runPriorityNP<Sink>(v);
+        default:                       return runRR<Sink>(v, q);
     }
+}
 
-    // Optional: sort by PID (already is), return
-    return ps;
+// Runs path p of engine e; secs gets the time spent simulating. Online runs
+// fill in only the timeline and the averages, MetricsSink runs no timeline.
+static Result runVerifyPath(VerifyPath p, ReplayEngine e, const vector<Process>& ps, int q,
+                            SimulationContext& ctx, double& secs) {
+    ProcessColumns cols = makeColumns(ps);
+    ProcessView v = cols.view();
+    Result r;
+    auto t0 = chrono::steady_clock::now();
+    switch (p) {
+        case VerifyPath::Timeline: r = runVerifySink<TimelineSink>(e, v, q); break;
+        case VerifyPath::Compact:
+            r = runVerifySink<CompactTimelineSink>(e, v, q);
+            r.timeline.assign(r.packed.begin(), r.packed.end());
+            break;
+        case VerifyPath::Metrics: r = runVerifySink<MetricsSink>(e, v, q); break;
+        case VerifyPath::Context:
+            switch (e) {
+                case ReplayEngine::FCFS:       r = ctx.runFCFS(v); break;
+                case ReplayEngine::SJF:        r = ctx.runSJF(v); break;
+                case ReplayEngine::PriorityNP: r = ctx.runPriorityNP(v); break;
+                default:                       r = ctx.runRR(v, q); break;
+            }
+            break;
+        case VerifyPath::Incremental: {
+            IncrementalRun inc(e, q);
+            inc.run(v);
+            Process edited;
+            verifyEdit(ps, edited);
+            SimTime since = min(v.arrival[edited.pid - 1], edited.arrival);
+            updateRow(cols, edited);
+            inc.invalidate(since);
+            t0 = chrono::steady_clock::now(); // only the rerun is timed
+            r = inc.run(cols.view());
+            break;
+        }
+        case VerifyPath::Online: {
+            OnlineScheduler sched(e == ReplayEngine::FCFS ? OnlinePolicy::FCFS
+                                : e == ReplayEngine::SJF ? OnlinePolicy::SJF
+                                : e == ReplayEngine::PriorityNP ? OnlinePolicy::PriorityNP : OnlinePolicy::RoundRobin, q);
+            for (size_t k = 0; k < v.n; ++k) {
+                uint32_t row = v.byArrival[k];
+                sched.submit({v.pid[row], v.arrival[row], v.burst[row], v.priority[row]});
+            }
+            sched.close();
+            sched.drainSegments(r.timeline);
+            r.avg_wait = sched.avgWait(); r.avg_tat = sched.avgTat();
+            break;
+        }
+        case VerifyPath::Smp: {
+            SmpOptions so;
+            so.cpus = 1; so.quantum = q;
+            so.policy = e == ReplayEngine::SJF ? SmpPolicy::SJF : e == ReplayEngine::PriorityNP ? SmpPolicy::Priority
+                                                                                                 : SmpPolicy::RoundRobin;
+            SmpResult res = runSMP(v, so);
+            r = move(res.metrics);
+            r.timeline = move(res.timelines[0]);
+            break;
+        }
+    }
+    secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    return r;
 }
 
-static vector<Process> demoDataset() {
-    // A small, mixed dataset with staggered arrivals
-    // PID assigned 1..5 automatically
-    vector<Process> ps = {
-        {1, 0,  7, 3},
-        {2, 2,  4, 1},
-        {3, 4,  1, 4},
-        {4, 5,  4, 2},
-        {5, 6,  6, 5}
+static string segmentText(const vector<Segment>& tl, size_t k) {
+    if (k >= tl.size()) return "end of timeline";
+    return segmentLabel(tl[k].pid) + " [" + to_string(tl[k].start) + ", " + to_string(tl[k].end) + ")";
+}
+
+// Empty when got matches ref. Metric vectors a path leaves empty (online
+// runs keep no per-PID table) are not compared.
+static string diffRuns(const Result& ref, const Result& got, bool timeline) {
+    if (timeline) {
+        const auto &a = ref.timeline, &b = got.timeline;
+        size_t k = 0;
+        while (k < a.size() && k < b.size() && a[k].pid == b[k].pid && a[k].start == b[k].start && a[k].end == b[k].end) ++k;
+        if (k < a.size() || k < b.size())
+            return "segment " + to_string(k) + ": expected " + segmentText(a, k) + ", got " + segmentText(b, k);
+    }
+    auto column = [&](const char *what, const vector<SimTime>& x, const vector<SimTime>& y) -> string {
+        if (y.empty()) return "";
+        if (x.size() != y.size()) return string(what) + ": " + to_string(y.size() - 1) + " PIDs, expected " + to_string(x.size() - 1);
+        for (size_t pid = 1; pid < x.size(); ++pid)
+            if (x[pid] != y[pid])
+                return string(what) + " of P" + to_string(pid) + ": expected " + to_string(x[pid]) + ", got " + to_string(y[pid]);
+        return "";
     };
-    return ps;
+    string d = column("completion", ref.completion, got.completion);
+    if (d.empty()) d = column("waiting", ref.waiting, got.waiting);
+    if (d.empty()) d = column("turnaround", ref.tat, got.tat);
+    if (d.empty() && (ref.avg_wait != got.avg_wait || ref.avg_tat != got.avg_tat)) {
+        ostringstream os;
+        os << setprecision(17) << "averages: expected " << ref.avg_wait << "/" << ref.avg_tat
+           << ", got " << got.avg_wait << "/" << got.avg_tat;
+        d = os.str();
+    }
+    return d;
 }
 
-// ---------- Comparison module ----------
+static bool hasTimeline(VerifyPath p) { return p != VerifyPath::Metrics; }
 
-static void compareAlgorithms(const vector<Process>& ps) {
-    if (ps.empty()) { cout << "\n[Info] No processes to compare. Please enter data first.\n"; return; }
+static string verifyMismatch(VerifyPath p, ReplayEngine e, const vector<Process>& ps, int q) {
+    SimulationContext ctx;
+    double secs;
+    return diffRuns(reference(e, verifyInput(p, ps), q), runVerifyPath(p, e, ps, q, ctx, secs), hasTimeline(p));
+}
 
-    Result r1 = runFCFS(ps);
-    Result r2 = runSJF(ps);
-    Result r3 = runPriorityNP(ps);
+// Greedy shrinking: drop processes one at a time (renumbering PIDs to stay
+// dense) for as long as the mismatch persists.
+static vector<Process> shrinkFailure(vector<Process> ps, VerifyPath p, ReplayEngine e, int q) {
+    for (bool smaller = true; smaller && ps.size() > 1;) {
+        smaller = false;
+        for (size_t i = 0; i < ps.size() && ps.size() > 1;) {
+            vector<Process> t;
+            for (size_t k = 0; k < ps.size(); ++k) {
+                if (k == i) continue;
+                Process x = ps[k];
+                if (x.pid > ps[i].pid) x.pid--;
+                t.push_back(x);
+            }
+            if (!verifyMismatch(p, e, t, q).empty()) { ps = move(t); smaller = true; }
+            else ++i;
+        }
+    }
+    return ps;
+}
 
-    int q = readInt("Enter time quantum for Round Robin (>0): ", 1, 1'000'000);
-    Result r4 = runRR(ps, q);
+// Ties, gaps and zero arrivals are the interesting cases, so the shape
+// cycles through all three; PIDs are then shuffled so (arrival, pid) order
+// differs from file order.
+static void verifyWorkload(const VerifySpec& s, mt19937_64& rng, vector<Process>& ps, size_t k) {
+    WorkloadSpec w;
+    w.n = 1 + rng() % max<size_t>(s.maxProcesses, 1);
+    w.arrivals = k % 3 == 0 ? ArrivalDist::AllAtZero : k % 3 == 1 ? ArrivalDist::Bursty : ArrivalDist::Poisson;
+    w.bursts = rng() % 4 ? BurstDist::Exponential : BurstDist::HeavyTailed;
+    w.meanGap = w.arrivals == ArrivalDist::Poisson ? 2.0 + rng() % 8 : 2.0;
+    w.meanBurst = 1.0 + rng() % 6;
+    w.burstGroup = 1 + (int)(rng() % 8);
+    w.priorities = 1 + (int)(rng() % 4);
+    generateWorkload(w, rng, ps);
+    vector<int> perm(ps.size());
+    iota(perm.begin(), perm.end(), 1);
+    shuffle(perm.begin(), perm.end(), rng);
+    for (size_t i = 0; i < ps.size(); ++i) ps[i].pid = perm[i];
+}
 
-    struct Row { string name; double aw; double at; };
-    vector<Row> rows = {
-        {r1.algo_name, r1.avg_wait, r1.avg_tat},
-        {r2.algo_name, r2.avg_wait, r2.avg_tat},
-        {r3.algo_name, r3.avg_wait, r3.avg_tat},
-        {r4.algo_name, r4.avg_wait, r4.avg_tat}
-    };
+// Returns false after reporting the first (shrunk) mismatch.
+static bool verifyEngines(const VerifySpec& s) {
+    struct Tally { size_t runs = 0, mismatches = 0; double refSecs = 0, secs = 0; };
+    Tally tally[kVerifyEngines][kVerifyPaths];
+    struct Failure { vector<Process> ps; VerifyPath path; ReplayEngine engine; int quantum; };
+    vector<Failure> first;
 
-    sort(rows.begin(), rows.end(), [](const Row& a, const Row& b){ return a.aw < b.aw; });
+    mt19937_64 rng(s.seed);
+    vector<Process> ps;
+    SimulationContext ctx;
+    auto t0 = chrono::steady_clock::now();
+    for (size_t k = 0; k < s.sets; ++k) {
+        verifyWorkload(s, rng, ps, k);
+        int q = s.quantum > 0 ? s.quantum : 1 + (int)(rng() % 8);
+        for (int ei = 0; ei < kVerifyEngines; ++ei) {
+            ReplayEngine e = (ReplayEngine)ei;
+            // The reference for the original and for the edited set
+            double refSecs[2];
+            Result ref[2];
+            for (int x = 0; x < 2; ++x) {
+                vector<Process> in = verifyInput(x ? VerifyPath::Incremental : VerifyPath::Timeline, ps);
+                auto r0 = chrono::steady_clock::now();
+                ref[x] = reference(e, in, q);
+                refSecs[x] = chrono::duration<double>(chrono::steady_clock::now() - r0).count();
+            }
+            for (int pi = 0; pi < kVerifyPaths; ++pi) {
+                VerifyPath p = (VerifyPath)pi;
+                if (!verifyApplies(e, p)) continue;
+                double secs;
+                Result got = runVerifyPath(p, e, ps, q, ctx, secs);
+                bool edited = p == VerifyPath::Incremental;
+                Tally &t = tally[ei][pi];
+                t.runs++; t.secs += secs; t.refSecs += refSecs[edited];
+                if (!diffRuns(ref[edited], got, hasTimeline(p)).empty()) {
+                    t.mismatches++;
+                    if (first.empty()) first.push_back({ps, p, e, q});
+                }
+            }
+        }
+    }
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
 
-    cout << "\n=== Algorithm Comparison (lower is better) ===\n";
-    cout << left << setw(28) << "Algorithm" << right << setw(18) << "Avg Waiting" << setw(22) << "Avg Turnaround" << "\n";
-    cout << string(28+18+22, '-') << "\n";
-    cout << fixed << setprecision(3);
-    for (auto &rw : rows) {
-        cout << left << setw(28) << rw.name << right << setw(18) << rw.aw << setw(22) << rw.at << "\n";
+    size_t runs = 0, mismatches = 0;
+    cout << "\n=== Differential Check (" << s.sets << " sets of 1.." << s.maxProcesses << " processes, "
+         << (s.quantum > 0 ? "q=" + to_string(s.quantum) : string("q in 1..8")) << ", seed " << s.seed << ") ===\n";
+    cout << left << setw(10) << "Engine" << setw(22) << "Path" << right << setw(8) << "Runs" << setw(12) << "Mismatches"
+         << setw(14) << "Reference s" << setw(10) << "Path s" << setw(10) << "Speedup" << "\n";
+    cout << string(10 + 22 + 8 + 12 + 14 + 10 + 10, '-') << "\n";
+    for (int ei = 0; ei < kVerifyEngines; ++ei) {
+        for (int pi = 0; pi < kVerifyPaths; ++pi) {
+            const Tally &t = tally[ei][pi];
+            if (!t.runs) continue;
+            runs += t.runs; mismatches += t.mismatches;
+            ostringstream speedup;
+            speedup << fixed << setprecision(1) << (t.secs > 0 ? t.refSecs / t.secs : 0.0) << "x";
+            cout << left << setw(10) << kVerifyEngineNames[ei] << setw(22) << kVerifyPathNames[pi] << right
+                 << setw(8) << t.runs << setw(12) << t.mismatches << fixed << setprecision(4)
+                 << setw(14) << t.refSecs << setw(10) << t.secs << setw(10) << speedup.str() << "\n";
+        }
+    }
+    cout << fixed << setprecision(2) << "\n[Info] " << runs << " runs in " << secs << " s.\n";
+    if (first.empty()) {
+        cout << "[Success] Every optimized path matched the reference schedules.\n\n";
+        return true;
     }
 
-    cout << "\nBest by Average Waiting Time: " << rows.front().name << "\n\n";
+    const Failure &f = first.front();
+    vector<Process> small = shrinkFailure(f.ps, f.path, f.engine, f.quantum);
+    cout << "[Error] " << mismatches << " mismatching run" << (mismatches == 1 ? "" : "s") << ". First: "
+         << kVerifyEngineNames[(int)f.engine] << " via " << kVerifyPathNames[(int)f.path]
+         << (f.engine == ReplayEngine::RoundRobin ? " (q=" + to_string(f.quantum) + ")" : string()) << ", shrunk from "
+         << f.ps.size() << " to " << small.size() << " process" << (small.size() == 1 ? "" : "es") << ":\n  "
+         << verifyMismatch(f.path, f.engine, small, f.quantum) << "\n";
+    if (f.path == VerifyPath::Incremental) {
+        Process edited;
+        verifyEdit(small, edited);
+        cout << "  (after editing P" << edited.pid << " to arrive at " << edited.arrival << " with burst " << edited.burst << ")\n";
+    }
+    cout << "Trace (pid,arrival,burst,priority):\n";
+    for (const auto &p : small) cout << p.pid << "," << p.arrival << "," << p.burst << "," << p.priority << "\n";
+    Result ref = reference(f.engine, verifyInput(f.path, small), f.quantum);
+    if (ref.timeline.size() <= kVerifyMaxShown) {
+        cout << "Reference timeline:\n";
+        for (size_t k = 0; k < ref.timeline.size(); ++k) cout << "  " << segmentText(ref.timeline, k) << "\n";
+    }
+    cout << "\n";
+    return false;
 }
 
-// ---------- Main menu ----------
+// ---------- Batch mode ----------
 
-static void runMenu() {
-    vector<Process> processes;
+static double peakRssMB() {
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0) return 0.0;
+    return ru.ru_maxrss / 1024.0; // Linux reports KiB
+}
 
-    cout << "\nCPU Scheduling Algorithm Simulator and Evaluator\n";
-    cout << "------------------------------------------------\n";
+static void printUsage(const char *prog) {
+    cerr << "Usage: " << prog << " [--input FILE [options]]\n"
+         << "       " << prog << " --monte-carlo K --quantum N [--input FILE] [options]\n"
+         << "       " << prog << " --workers HOST:PORT,... --input FILE [--input FILE...] [options]\n"
+         << "       " << prog << " --worker PORT [--bind ADDR --trace-root DIR]\n"
+         << "       " << prog << " --verify K [--quantum N] [--seed N] [--processes N]\n"
+         << "  (no arguments)       start the interactive menu\n"
+         << "  --input FILE         trace file to simulate (CSV or binary)\n"
+         << "  --format csv|bin     trace format (default: detect from contents)\n"
+         << "  --algo NAME          fcfs | sjf | priority | rr | srtf | priority-p | mlfq\n"
+         << "                       | lottery | stride | all (default: all)\n"
+         << "  --quantum N          time quantum (required for rr/lottery/stride/all); MLFQ\n"
+         << "                       defaults to levels N,2N,4N with a boost every 64N\n"
+         << "  --levels LIST        MLFQ quantum per level, highest level first, e.g. 2,4,8\n"
+         << "  --boost N            MLFQ priority boost period (0 = never)\n"
+         << "  --coalesce           merge back-to-back RR slices of a lone process\n"
+         << "  --rank METRIC        with --algo all: rank by p99-wait, max-response,\n"
+         << "                       fairness, ... (" << kRankHelp << ";\n"
+         << "                       default: avg-wait)\n"
+         << "  --cpus M             simulate M CPUs with per-CPU run queues\n"
+         << "                       (--algo rr, sjf or priority)\n"
+         << "  --steal              with --cpus: idle CPUs steal from the busiest queue\n"
+         << "  --least-loaded       with --cpus: place arrivals on the least loaded CPU\n"
+         << "                       (default: by PID, round robin)\n"
+         << "  --sweep LIST         evaluate RR at many quanta, e.g. 1..256 or 1,2,4,8\n"
+         << "  --argmin             with --sweep: print only the best quantum, pruning\n"
+         << "                       runs that cannot beat it\n"
+         << "  --gantt FILE         also write the timeline(s) as SVG, or HTML if FILE\n"
+         << "                       ends in .html (single algorithm or --cpus)\n"
+         << "  --export FILE        write the run's timeline and per-process metrics as a\n"
+         << "                       flat binary result file (layout above writeResult)\n"
+         << "  --compact            keep the timeline delta/run-length encoded in memory\n"
+         << "                       (single algorithm; same output, far less memory for\n"
+         << "                       rr/mlfq/lottery/stride with small quanta)\n"
+         << "  --inspect            after a single-algorithm run, page through its table,\n"
+         << "                       draw a time window of its Gantt chart or list one PID's\n"
+         << "                       segments, answering prompts on stdin (menu option 18)\n"
+         << "  --table              print the per-process table even for runs with more\n"
+         << "                       than " << kMaxTableRows << " processes\n"
+         << "  --convert OUT        write the trace as a memory-mappable process set\n"
+         << "                       (read back with --input OUT) and exit\n"
+         << "  --stream             treat --input (a CSV file, FIFO or - for stdin) as a live\n"
+         << "                       feed in arrival order: print segments as \"pid,start,end\"\n"
+         << "                       lines as soon as they are decided, summary on stderr\n"
+         << "                       (fcfs, sjf, priority, rr, srtf, priority-p)\n"
+         << "  --pipeline           read, validate and simulate --input (CSV or binary,\n"
+         << "                       sorted by arrival, then PID) concurrently on three\n"
+         << "                       threads and print the summary (the algorithms of\n"
+         << "                       --stream)\n"
+         << "  --switch-cost N      charge N time units for every context switch; shown\n"
+         << "                       as CS segments (single CPU: every --algo, --sweep)\n"
+         << "  --warmup N           with --switch-cost: N more when switching to a process\n"
+         << "                       other than the one that ran last\n"
+         << "  --monte-carlo K      run every algorithm over K random workloads shaped like\n"
+         << "                       --input (default: the demo set) and report means with\n"
+         << "                       95% confidence intervals\n"
+         << "  --seed N             with --monte-carlo, --verify or --algo lottery: RNG seed\n"
+         << "                       (default: 1)\n"
+         << "  --processes N        with --monte-carlo: processes per workload (--verify: at most)\n"
+         << "  --arrivals poisson|bursty|zero  with --monte-carlo: arrival pattern\n"
+         << "  --bursts exp|pareto  with --monte-carlo: burst distribution (default: exp)\n"
+         << "  --workers LIST       run a comparison grid on the listed workers: every\n"
+         << "                       --input x --algo (a list, or all) x --sweep/--quantum x\n"
+         << "                       --cpus (a list) is one unit; the table pools each\n"
+         << "                       configuration over all inputs, which every worker must\n"
+         << "                       be able to open under the same path\n"
+         << "  --retries N          with --workers: resend a failed unit up to N times\n"
+         << "                       (default: 3)\n"
+         << "  --worker PORT        serve grid units to a coordinator on TCP port PORT.\n"
+         << "                       The protocol is unauthenticated and units name files\n"
+         << "                       to open, so the worker listens on 127.0.0.1 only;\n"
+         << "                       any host that can connect can read what it may open\n"
+         << "  --bind ADDR          with --worker: listen on ADDR instead (e.g. a cluster\n"
+         << "                       interface, or :: for all); a non-loopback ADDR needs\n"
+         << "                       --trace-root\n"
+         << "  --trace-root DIR     with --worker: open only traces under DIR (symlinks and\n"
+         << "                       .. resolved); use only on a network you trust with them\n"
+         << "  --verify K           check the optimized engines against the reference FCFS,\n"
+         << "                       SJF, Priority and RR on K random sets (ties, idle gaps,\n"
+         << "                       all-at-zero arrivals) and report their speedups; a\n"
+         << "                       mismatch is shrunk and printed as a trace (exit 1).\n"
+         << "                       --processes caps the set size (default 64), --quantum\n"
+         << "                       fixes the RR quantum (default: drawn from 1..8)\n"
+         << "  --counters table|json  dump per-run engine counters and phase timers to\n"
+         << "                       stderr (needs a build with -DSCHED_INSTRUMENT)\n"
+         << "  --help               show this message\n";
+}
 
-    if (readYesNo("Load a demo dataset to get started?", true)) {
-        processes = demoDataset();
-        printProcessTable(processes);
-    }
+struct BatchOptions {
+    string input, format, algo = "all", convert, gantt, exportPath, counters;
+    int quantum = 0;
+    bool coalesce = false, table = false, stream = false, compact = false, pipeline = false, inspect = false;
+    vector<int> sweep;
+    bool argmin = false;
+    int cpus = 0;
+    bool steal = false, leastLoaded = false;
+    vector<int> levels;
+    int boost = -1; // -1: the defaultMlfq period
+    RankMetric rank;
+    long long monteCarlo = 0, seed = 1, processes = 0, verify = 0;
+    DispatchCost dispatch;
+    string arrivals, bursts;
+    // Distributed grid: every --input, every --cpus count, the worker side
+    vector<string> inputs, workers;
+    vector<int> cpuList;
+    int retries = 3, workerPort = 0;
+    string bind, traceRoot;
+};
 
-    while (true) {
-        cout << "\nMenu:\n";
-        cout << " 1) Enter / Replace processes\n";
-        cout << " 2) Show current processes\n";
-        cout << " 3) Run FCFS\n";
-        cout << " 4) Run SJF (Non-Preemptive)\n";
-        cout << " 5) Run Round Robin\n";
-        cout << " 6) Run Priority (Non-Preemptive)\n";
-        cout << " 7) Compare All (with RR quantum)\n";
-        cout << " 0) Exit\n";
+static vector<string> splitList(const string &s) {
+    vector<string> out;
+    stringstream in(s);
+    for (string item; getline(in, item, ',');) if (!item.empty()) out.push_back(item);
+    return out;
+}
 
-        int choice = readInt("Choose an option: ", 0, 7);
-        if (choice == 0) {
-            cout << "Goodbye!\n"; break;
+// Returns false (after reporting) when the command line is malformed.
+static bool parseBatchArgs(int argc, char **argv, BatchOptions &o) {
+    for (int k = 1; k < argc; ++k) {
+        string arg = argv[k];
+        auto value = [&]() -> const char* {
+            if (k + 1 >= argc) { cerr << "[Error] " << arg << " needs a value.\n"; return nullptr; }
+            return argv[++k];
+        };
+        const char *v = nullptr;
+        if (arg == "--help" || arg == "-h") { printUsage(argv[0]); exit(0); }
+        else if (arg == "--coalesce") o.coalesce = true;
+        else if (arg == "--argmin")   o.argmin = true;
+        else if (arg == "--table")    o.table = true;
+        else if (arg == "--inspect")  o.inspect = true;
+        else if (arg == "--stream")   o.stream = true;
+        else if (arg == "--compact")  o.compact = true;
+        else if (arg == "--pipeline") o.pipeline = true;
+        else if (arg == "--steal")    o.steal = true;
+        else if (arg == "--least-loaded") o.leastLoaded = true;
+        else if (arg == "--cpus") {
+            if (!(v = value())) return false;
+            o.cpuList.clear();
+            bool ok = parseQuantumList(v, o.cpuList);
+            for (int m : o.cpuList) ok = ok && m <= kMaxCpus;
+            if (!ok) { cerr << "[Error] --cpus must be in [1, " << kMaxCpus << "] (a list with --workers).\n"; return false; }
+            o.cpus = o.cpuList.front();
         }
-
-        switch (choice) {
-            case 1: {
-                processes = enterProcesses();
-                cout << "\n[Success] Process list updated.\n";
-                break;
-            }
-            case 2: {
-                if (processes.empty()) cout << "\n[Info] No processes loaded.\n";
-                else printProcessTable(processes);
-                break;
-            }
-            case 3: {
-                if (processes.empty()) { cout << "\n[Info] No processes loaded.\n"; break; }
-                Result r = runFCFS(processes);
-                printResult(r, processes);
-                break;
-            }
-            case 4: {
-                if (processes.empty()) { cout << "\n[Info] No processes loaded.\n"; break; }
-                Result r = runSJF(processes);
-                printResult(r, processes);
-                break;
-            }
-            case 5: {
-                if (processes.empty()) { cout << "\n[Info] No processes loaded.\n"; break; }
-                int q = readInt("Enter time quantum (>0): ", 1, 1'000'000);
-                Result r = runRR(processes, q);
-                printResult(r, processes);
-                break;
+        else if (arg == "--worker" || arg == "--retries") {
+            if (!(v = value())) return false;
+            long long lo = arg == "--worker" ? 1 : 0, hi = arg == "--worker" ? 65535 : 100;
+            char *end; long long x = strtoll(v, &end, 10);
+            if (*end || !*v || x < lo || x > hi) { cerr << "[Error] " << arg << " must be in [" << lo << ", " << hi << "].\n"; return false; }
+            (arg == "--worker" ? o.workerPort : o.retries) = (int)x;
+        }
+        else if (arg == "--bind")       { if (!(v = value())) return false; o.bind = v; }
+        else if (arg == "--trace-root") { if (!(v = value())) return false; o.traceRoot = v; }
+        else if (arg == "--workers") {
+            if (!(v = value())) return false;
+            o.workers = splitList(v);
+            if (o.workers.empty()) { cerr << "[Error] --workers needs host:port[,host:port...].\n"; return false; }
+        }
+        else if (arg == "--sweep") {
+            if (!(v = value())) return false;
+            if (!parseQuantumList(v, o.sweep)) { cerr << "[Error] Bad --sweep list '" << v << "'.\n"; return false; }
+        }
+        else if (arg == "--levels") {
+            if (!(v = value())) return false;
+            if (!parseQuantumList(v, o.levels) || o.levels.size() > (size_t)kMaxMlfqLevels) {
+                cerr << "[Error] Bad --levels list '" << v << "' (1.." << kMaxMlfqLevels << " quanta).\n"; return false;
             }
-            case 6: {
-                if (processes.empty()) { cout << "\n[Info] No processes loaded.\n"; break; }
-                Result r = runPriorityNP(processes);
-                printResult(r, processes);
-                break;
+        }
+        else if (arg == "--boost") {
+            if (!(v = value())) return false;
+            char *end; long long b = strtoll(v, &end, 10);
+            if (*end || b < 0 || b > 1'000'000'000) { cerr << "[Error] --boost must be in [0, 1000000000].\n"; return false; }
+            o.boost = (int)b;
+        }
+        else if (arg == "--monte-carlo" || arg == "--verify" || arg == "--seed" || arg == "--processes") {
+            if (!(v = value())) return false;
+            long long hi = arg == "--monte-carlo" || arg == "--verify" ? kMaxMcWorkloads : arg == "--processes" ? 100'000'000 : LLONG_MAX;
+            long long lo = arg == "--seed" ? 0 : 1;
+            char *end; errno = 0; long long x = strtoll(v, &end, 10);
+            if (*end || !*v || errno || x < lo || x > hi) { cerr << "[Error] " << arg << " must be in [" << lo << ", " << hi << "].\n"; return false; }
+            (arg == "--monte-carlo" ? o.monteCarlo : arg == "--verify" ? o.verify : arg == "--seed" ? o.seed : o.processes) = x;
+        }
+        else if (arg == "--switch-cost" || arg == "--warmup") {
+            if (!(v = value())) return false;
+            char *end; long long c = strtoll(v, &end, 10);
+            if (*end || !*v || c < 0 || c > kMaxBurst) { cerr << "[Error] " << arg << " must be in [0, " << kMaxBurst << "].\n"; return false; }
+            (arg == "--switch-cost" ? o.dispatch.cost : o.dispatch.warmup) = (SimTime)c;
+        }
+        else if (arg == "--arrivals") {
+            if (!(v = value())) return false;
+            o.arrivals = v;
+            if (o.arrivals != "poisson" && o.arrivals != "bursty" && o.arrivals != "zero") { cerr << "[Error] --arrivals takes poisson, bursty or zero.\n"; return false; }
+        }
+        else if (arg == "--bursts") {
+            if (!(v = value())) return false;
+            o.bursts = v;
+            if (o.bursts != "exp" && o.bursts != "pareto") { cerr << "[Error] --bursts takes exp or pareto.\n"; return false; }
+        }
+        else if (arg == "--rank") {
+            if (!(v = value())) return false;
+            if (!parseRankMetric(v, o.rank)) { cerr << "[Error] Unknown --rank metric '" << v << "'.\n"; return false; }
+        }
+        else if (arg == "--input")   { if (!(v = value())) return false; o.input = v; o.inputs.push_back(v); }
+        else if (arg == "--format")  { if (!(v = value())) return false; o.format = v; }
+        else if (arg == "--algo")    { if (!(v = value())) return false; o.algo = v; }
+        else if (arg == "--convert") { if (!(v = value())) return false; o.convert = v; }
+        else if (arg == "--gantt")   { if (!(v = value())) return false; o.gantt = v; }
+        else if (arg == "--export")  { if (!(v = value())) return false; o.exportPath = v; }
+        else if (arg == "--counters") {
+            if (!(v = value())) return false;
+            o.counters = v;
+            if (o.counters != "table" && o.counters != "json") { cerr << "[Error] --counters takes table or json.\n"; return false; }
+#ifndef SCHED_INSTRUMENT
+            cerr << "[Error] --counters needs a build with -DSCHED_INSTRUMENT.\n"; return false;
+#endif
+        }
+        else if (arg == "--quantum") {
+            if (!(v = value())) return false;
+            char *end; long long q = strtoll(v, &end, 10);
+            if (*end || q < 1 || q > kMaxQuantum) { cerr << "[Error] --quantum must be in [1, " << kMaxQuantum << "].\n"; return false; }
+            o.quantum = (int)q;
+        }
+        else { cerr << "[Error] Unknown option '" << arg << "'.\n"; return false; }
+    }
+    if (o.workerPort > 0) {
+        if (argc != 3 + (o.bind.empty() ? 0 : 2) + (o.traceRoot.empty() ? 0 : 2)) {
+            cerr << "[Error] --worker takes no options but --bind and --trace-root.\n"; return false;
+        }
+        return true;
+    }
+    if (!o.bind.empty() || !o.traceRoot.empty()) { cerr << "[Error] --bind and --trace-root need --worker.\n"; return false; }
+    if (o.verify > 0) {
+        if (!o.inputs.empty() || !o.format.empty() || o.algo != "all" || !o.workers.empty() || o.stream || o.pipeline ||
+            o.monteCarlo > 0 || o.cpus > 0 || !o.sweep.empty() || !o.convert.empty() || !o.gantt.empty() ||
+            !o.exportPath.empty() || !o.counters.empty() || o.coalesce || o.table || o.compact || o.inspect || o.argmin ||
+            o.steal || o.leastLoaded || !o.levels.empty() || o.boost >= 0 || !o.dispatch.none() ||
+            !o.arrivals.empty() || !o.bursts.empty()) {
+            cerr << "[Error] --verify draws its own process sets and takes only --quantum, --seed and --processes.\n";
+            return false;
+        }
+        if (o.processes > 100'000) { cerr << "[Error] --processes must be at most 100000 with --verify.\n"; return false; }
+        return true;
+    }
+    if (!o.workers.empty()) {
+        if (o.inputs.empty()) { cerr << "[Error] --workers needs at least one --input.\n"; return false; }
+        for (const string &a : splitList(o.algo)) {
+            if (a != "all" && find(begin(kGridAlgos), end(kGridAlgos), a) == end(kGridAlgos)) {
+                cerr << "[Error] Unknown algorithm '" << a << "'.\n"; return false;
             }
-            case 7: {
-                compareAlgorithms(processes);
-                break;
+        }
+        if (o.stream || o.pipeline || o.monteCarlo > 0 || !o.convert.empty() || !o.gantt.empty() || !o.exportPath.empty() ||
+            o.argmin || o.table || o.compact || o.inspect) {
+            cerr << "[Error] --workers runs a comparison grid and takes no --stream/--pipeline/--monte-carlo/\n"
+                 << "        --convert/--gantt/--export/--argmin/--table/--compact/--inspect.\n";
+            return false;
+        }
+        if (o.seed != 1 && o.algo.find("lottery") == string::npos && o.algo != "all") {
+            cerr << "[Error] --seed needs lottery in the grid.\n"; return false;
+        }
+        if (o.quantum == 0 && o.sweep.empty()) { cerr << "[Error] --workers needs --quantum or --sweep.\n"; return false; }
+        if (!o.dispatch.none() && *max_element(o.cpuList.begin(), o.cpuList.end()) > 1) {
+            cerr << "[Error] --switch-cost and --warmup apply to single-CPU runs, not --cpus above 1.\n"; return false;
+        }
+        return true;
+    }
+    if (o.inputs.size() > 1) { cerr << "[Error] more than one --input needs --workers.\n"; return false; }
+    if (o.cpuList.size() > 1) { cerr << "[Error] a list of --cpus counts needs --workers.\n"; return false; }
+    if (o.retries != 3) { cerr << "[Error] --retries needs --workers.\n"; return false; }
+    if (o.monteCarlo > 0) {
+        if (o.algo != "all" || o.stream || o.cpus > 0 || !o.sweep.empty() || !o.convert.empty() ||
+            !o.gantt.empty() || !o.exportPath.empty()) {
+            cerr << "[Error] --monte-carlo runs every algorithm and takes no --algo/--stream/--cpus/\n"
+                 << "        --sweep/--convert/--gantt/--export.\n";
+            return false;
+        }
+    } else if ((o.seed != 1 && o.algo != "lottery") || o.processes > 0 || !o.arrivals.empty() || !o.bursts.empty()) {
+        cerr << "[Error] --seed, --processes, --arrivals and --bursts need --monte-carlo\n"
+             << "        (--seed also applies to --algo lottery).\n";
+        return false;
+    }
+    if (o.input.empty() && o.monteCarlo == 0) { cerr << "[Error] --input is required.\n"; return false; }
+    static const char *algos[] = {"fcfs", "sjf", "priority", "rr", "srtf", "priority-p", "mlfq", "lottery", "stride", "all"};
+    if (find(begin(algos), end(algos), o.algo) == end(algos)) {
+        cerr << "[Error] Unknown algorithm '" << o.algo << "'.\n"; return false;
+    }
+    if ((!o.gantt.empty() || !o.exportPath.empty()) && (o.algo == "all" || !o.sweep.empty())) {
+        cerr << "[Error] --gantt and --export need a single algorithm.\n"; return false;
+    }
+    if (o.stream || o.pipeline) {
+        const char *mode = o.stream ? "--stream" : "--pipeline";
+        if (o.algo == "all" || o.algo == "mlfq" || o.algo == "lottery" || o.algo == "stride" || o.cpus > 0 || !o.sweep.empty() || !o.convert.empty() ||
+            !o.gantt.empty() || !o.exportPath.empty() || o.coalesce || o.compact || o.table || (o.stream && o.pipeline)) {
+            cerr << "[Error] " << mode << " runs one of fcfs, sjf, priority, rr, srtf, priority-p and takes no\n"
+                 << "        --cpus/--sweep/--convert/--gantt/--export/--coalesce/--compact/--table/--" << (o.stream ? "pipeline" : "stream") << ".\n";
+            return false;
+        }
+        if (o.stream && !o.format.empty() && o.format != "csv") { cerr << "[Error] --stream reads CSV only.\n"; return false; }
+    }
+    if (!o.dispatch.none() && (o.stream || o.pipeline || o.cpus > 0 || o.monteCarlo > 0)) {
+        cerr << "[Error] --switch-cost and --warmup apply to single-CPU runs, not --stream/--pipeline/--cpus/--monte-carlo.\n";
+        return false;
+    }
+    if (o.inspect && (o.algo == "all" || o.compact || o.stream || o.pipeline || o.cpus > 0 || !o.sweep.empty() ||
+                      o.monteCarlo > 0 || !o.convert.empty() || o.input == "-")) {
+        cerr << "[Error] --inspect needs one single-CPU --algo run over an --input file, not all/--compact/\n"
+             << "        --stream/--pipeline/--cpus/--sweep/--monte-carlo/--convert.\n";
+        return false;
+    }
+    if (o.argmin && o.sweep.empty()) { cerr << "[Error] --argmin needs --sweep.\n"; return false; }
+    if (o.compact && (o.algo == "all" || o.stream || o.cpus > 0 || !o.sweep.empty() || o.monteCarlo > 0)) {
+        cerr << "[Error] --compact applies to one single-CPU --algo run, not all/--stream/--cpus/--sweep/--monte-carlo.\n";
+        return false;
+    }
+    if (o.cpus > 0 && o.algo != "rr" && o.algo != "sjf" && o.algo != "priority") {
+        cerr << "[Error] --cpus supports --algo rr, sjf or priority.\n"; return false;
+    }
+    bool sliced = o.algo == "rr" || o.algo == "lottery" || o.algo == "stride" || o.algo == "all";
+    if (o.convert.empty() && o.sweep.empty() && sliced && o.quantum == 0) {
+        cerr << "[Error] --quantum is required for " << o.algo << ".\n"; return false;
+    }
+    if (o.convert.empty() && o.algo == "mlfq" && o.levels.empty() && o.quantum == 0) {
+        cerr << "[Error] --algo mlfq needs --levels or --quantum.\n"; return false;
+    }
+    return true;
+}
+
+// --stream: feeds the trace to an OnlineScheduler line by line and writes
+// each decided segment to stdout; output is flushed whenever the reader has
+// no complete line left, i.e. right before it would wait for the producer.
+static OnlinePolicy onlinePolicy(const string &algo) {
+    return algo == "fcfs" ? OnlinePolicy::FCFS
+         : algo == "sjf" ? OnlinePolicy::SJF
+         : algo == "priority" ? OnlinePolicy::PriorityNP
+         : algo == "rr" ? OnlinePolicy::RoundRobin
+         : algo == "srtf" ? OnlinePolicy::SRTF : OnlinePolicy::PriorityP;
+}
+
+static int runStream(const BatchOptions &o) {
+    OnlineScheduler sched(onlinePolicy(o.algo), o.quantum);
+
+    FilePtr owned;
+    FILE *f = stdin;
+    if (o.input != "-") { owned = openFile(o.input, "rb"); f = owned.get(); }
+    ChunkReader in(f, 1 << 16, true);
+
+    vector<Segment> segs;
+    string out;
+    size_t streamed = 0;
+    auto flush = [&](bool force) {
+        sched.drainSegments(segs);
+        char line[48];
+        for (const auto &sg : segs) out.append(line, snprintf(line, sizeof line, "%d,%lld,%lld\n", sg.pid, (long long)sg.start, (long long)sg.end));
+        streamed += segs.size();
+        segs.clear();
+        if (force || out.size() >= (1 << 16)) {
+            fwrite(out.data(), 1, out.size(), stdout);
+            if (force) fflush(stdout);
+            out.clear();
+        }
+    };
+
+    auto t0 = chrono::steady_clock::now();
+    forEachCsvRecord(in, [&](const Process &proc, size_t line) {
+        try { sched.submit(proc); }
+        catch (const runtime_error &e) { throw runtime_error(traceError(line, e.what())); }
+        flush(!in.hasLine());
+    });
+    sched.close();
+    flush(true);
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+
+    const RunStats &st = sched.stats();
+    cerr << fixed << setprecision(2)
+         << "[Info] " << sched.name() << ": streamed " << sched.completed() << " processes, "
+         << streamed << " segments in " << secs << " s ("
+         << (secs > 0 ? (sched.completed() + streamed) / secs : 0.0) << " events/s), peak "
+         << sched.peakActive() << " active\n"
+         << "[Info] Average Waiting Time: " << sched.avgWait()
+         << ", Average Turnaround Time: " << sched.avgTat()
+         << ", p99 wait " << st.wait.quantile(0.99) << ", fairness " << setprecision(4) << st.fairness() << "\n"
+         << setprecision(1) << "[Info] Peak RSS: " << peakRssMB() << " MB\n";
+    return 0;
+}
+
+// --pipeline: pipeTrace feeds an OnlineScheduler, so the run finishes about
+// when the slowest of reading, validating and simulating does. The timeline
+// is counted and dropped as it is decided; the summary goes to stdout.
+static int runPipeline(const BatchOptions &o) {
+    OnlineScheduler sched(onlinePolicy(o.algo), o.quantum);
+    vector<Segment> segs;
+    size_t segments = 0;
+    PipelineStats st;
+    pipeTrace(o.input, o.format, [&](const vector<Process> &batch) {
+        for (const Process &p : batch) sched.submit(p);
+        sched.drainSegments(segs);
+        segments += segs.size();
+        segs.clear();
+    }, st);
+    // Whatever is still queued at the end of the feed runs now, unoverlapped
+    auto t0 = chrono::steady_clock::now();
+    sched.close();
+    sched.drainSegments(segs);
+    segments += segs.size();
+    double tail = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    st.busy[2] += tail; st.wall += tail;
+
+    cout << "\n=== " << sched.name() << " Result (pipelined) ===\n";
+    cout << "\nProcesses: " << sched.completed() << "   Segments: " << segments << "   Makespan: " << sched.now()
+         << "   Peak active: " << sched.peakActive() << "\n";
+    cout << fixed << setprecision(2);
+    cout << "\nAverage Waiting Time   : " << sched.avgWait() << "\n";
+    cout << "Average Turnaround Time: " << sched.avgTat() << "\n";
+    printDistributions(sched.stats());
+    cout << "\n";
+
+    double serial = st.busy[0] + st.busy[1] + st.busy[2];
+    cerr << fixed << setprecision(2)
+         << "[Info] Pipeline over " << st.records << " records (" << st.bytes / 1e6 << " MB): read+parse "
+         << st.busy[0] << " s, validate " << st.busy[1] << " s, simulate " << st.busy[2] << " s busy; "
+         << st.wall << " s wall (" << (st.wall > 0 ? serial / st.wall : 0.0) << "x overlap)\n"
+         << setprecision(1) << "[Info] Peak RSS: " << peakRssMB() << " MB\n";
+    return 0;
+}
+
+// One single-CPU --algo run recorded by Sink (TimelineSink, or
+// CompactTimelineSink for --compact).
+template <class Sink>
+static Result runAlgorithm(const BatchOptions &o, const ProcessView &ps) {
+    const DispatchCost &dc = o.dispatch;
+    if (o.algo == "fcfs")            return runFCFS<Sink>(ps, dc);
+    if (o.algo == "sjf")             return runSJF<Sink>(ps, dc);
+    if (o.algo == "priority")        return runPriorityNP<Sink>(ps, dc);
+    if (o.algo == "srtf")            return runSRTF<Sink>(ps, dc);
+    if (o.algo == "priority-p")      return runPriorityP<Sink>(ps, dc);
+    if (o.algo == "mlfq") {
+        MlfqOptions mo = defaultMlfq(o.quantum);
+        if (!o.levels.empty()) { mo.quanta = o.levels; mo.boost = 0; }
+        if (o.boost >= 0) mo.boost = o.boost;
+        return runMLFQ<Sink>(ps, mo, dc);
+    }
+    if (o.algo == "lottery")         return runLottery<Sink>(ps, o.quantum, (uint64_t)o.seed, dc);
+    if (o.algo == "stride")          return runStride<Sink>(ps, o.quantum, dc);
+    return runRR<Sink>(ps, o.quantum, o.coalesce, dc);
+}
+
+static int runBatch(int argc, char **argv) {
+    BatchOptions o;
+    if (!parseBatchArgs(argc, argv, o)) { printUsage(argv[0]); return 2; }
+    if (o.stream) return runStream(o);
+    if (o.pipeline) return runPipeline(o);
+    if (o.verify > 0) {
+        VerifySpec s;
+        s.sets = (size_t)o.verify; s.quantum = o.quantum; s.seed = (uint64_t)o.seed;
+        if (o.processes > 0) s.maxProcesses = (size_t)o.processes;
+        return verifyEngines(s) ? 0 : 1;
+    }
+    if (o.workerPort > 0) return runGridWorker(o.workerPort, o.bind, o.traceRoot);
+    if (!o.workers.empty()) {
+        GridSpec g;
+        g.traces = o.inputs; g.workers = o.workers; g.format = o.format;
+        g.algos = splitList(o.algo);
+        if (!o.sweep.empty()) g.quanta = o.sweep;
+        else g.quanta = {o.quantum};
+        if (!o.cpuList.empty()) g.cpus = o.cpuList;
+        g.coalesce = o.coalesce; g.steal = o.steal; g.leastLoaded = o.leastLoaded;
+        g.dc = o.dispatch; g.seed = (uint64_t)o.seed; g.retries = o.retries; g.rank = o.rank;
+        return runGrid(g) ? 0 : 1;
+    }
+
+    LoadedSet set;
+    if (o.input.empty()) { // --monte-carlo without a template
+        makeColumns(demoDataset(), set.cols);
+        set.view = set.cols.view();
+    } else {
+        openProcessSet(o.input, o.format, set);
+    }
+    const ProcessView &ps = set.view;
+
+    if (!o.convert.empty()) {
+        writeProcessSet(o.convert, ps);
+        cerr << "[Success] Wrote process set '" << o.convert << "'.\n";
+        return 0;
+    }
+    if (ps.n == 0) { cout << "\n[Info] Trace contains no processes.\n"; return 0; }
+    if (!o.dispatch.none()) { // the smallest quantum the run slices with, 0 for none
+        int q = !o.sweep.empty() ? *min_element(o.sweep.begin(), o.sweep.end())
+              : o.algo == "mlfq" && !o.levels.empty() ? *min_element(o.levels.begin(), o.levels.end())
+              : o.algo == "rr" || o.algo == "mlfq" || o.algo == "lottery" || o.algo == "stride" || o.algo == "all" ? o.quantum : 0;
+        checkDispatchBudget(ps, o.dispatch, q);
+    }
+
+    if (o.cpus > 0) {
+        SmpOptions so;
+        so.cpus = o.cpus; so.quantum = o.quantum; so.steal = o.steal; so.leastLoaded = o.leastLoaded;
+        so.policy = o.algo == "rr" ? SmpPolicy::RoundRobin : o.algo == "sjf" ? SmpPolicy::SJF : SmpPolicy::Priority;
+        SmpResult res = runSMP(ps, so);
+        printSmpResult(res, ps, o.table);
+        if (!o.exportPath.empty()) writeResult(o.exportPath, res.metrics); // per-CPU timelines: see --gantt
+        if (!o.gantt.empty()) {
+            vector<const vector<Segment>*> rows;
+            vector<string> names;
+            for (size_t c = 0; c < res.timelines.size(); ++c) {
+                rows.push_back(&res.timelines[c]);
+                names.push_back("CPU " + to_string(c));
             }
+            exportGantt(o.gantt, res.metrics.algo_name, rows, names);
+        }
+    }
+    else if (o.monteCarlo > 0) {
+        MonteCarloSpec mc;
+        mc.workload = fitWorkload(ps);
+        if (o.processes > 0) mc.workload.n = (size_t)o.processes;
+        if (!o.arrivals.empty())
+            mc.workload.arrivals = o.arrivals == "poisson" ? ArrivalDist::Poisson
+                                 : o.arrivals == "bursty" ? ArrivalDist::Bursty : ArrivalDist::AllAtZero;
+        if (!o.bursts.empty()) mc.workload.bursts = o.bursts == "exp" ? BurstDist::Exponential : BurstDist::HeavyTailed;
+        mc.workloads = (size_t)o.monteCarlo;
+        mc.quantum = o.quantum;
+        mc.seed = (uint64_t)o.seed;
+        monteCarlo(mc);
+    }
+    else if (!o.sweep.empty())     sweepQuanta(ps, o.sweep, o.argmin, o.dispatch);
+    else if (o.algo == "all")      compareAlgorithms(ps, o.quantum, o.rank, o.dispatch);
+    else {
+        Result r = o.compact ? runAlgorithm<CompactTimelineSink>(o, ps) : runAlgorithm<TimelineSink>(o, ps);
+        printResult(r, ps, o.table);
+        if (o.compact)
+            cerr << "[Info] Compact timeline: " << r.packed.size() << " segments in " << r.packed.bytes() << " bytes ("
+                 << fixed << setprecision(1) << (double)r.packed.size() * sizeof(Segment) / max<size_t>(r.packed.bytes(), 1)
+                 << "x smaller than Segment records).\n";
+        if (!o.gantt.empty()) {
+            if (o.compact) exportGantt<CompactTimeline>(o.gantt, r.algo_name, {&r.packed}, {"CPU"});
+            else exportGantt<vector<Segment>>(o.gantt, r.algo_name, {&r.timeline}, {"CPU"});
+        }
+        if (!o.exportPath.empty()) writeResult(o.exportPath, r);
+        if (o.inspect) {
+            cin.tie(&cout); // each prompt must show before its read
+            ResultInspector in;
+            in.keep(move(r));
+            inspectResult(in, ps);
         }
     }
+    if (!o.gantt.empty()) cerr << "[Success] Wrote Gantt chart '" << o.gantt << "'.\n";
+    if (!o.exportPath.empty()) cerr << "[Success] Wrote result file '" << o.exportPath << "'.\n";
+
+    cout.flush();
+#ifdef SCHED_INSTRUMENT
+    if (!o.counters.empty()) dumpInstrumentation(o.counters == "json");
+#endif
+    cerr << fixed << setprecision(1) << "[Info] Peak RSS: " << peakRssMB() << " MB\n";
+    return 0;
 }
 
-int main() {
+int main(int argc, char **argv) {
     ios::sync_with_stdio(false);
     cin.tie(nullptr);
 
     try {
+        if (argc > 1) return runBatch(argc, argv);
         runMenu();
     } catch (const exception &e) {
         cerr << "\n[Fatal Error] " << e.what() << "\n";
@@ -555,3 +6372,4 @@ int main() {
     }
     return 0;
 }
+#endif
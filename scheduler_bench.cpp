@@ -0,0 +1,266 @@
+// Benchmarks for the scheduling engines (Google Benchmark)
+// -------------------------------------------------------------
+// - Drives runFCFS, runSJF, runPriorityNP, runSRTF, runPriorityP, runRR,
+//   runMLFQ (levels 4/8/16), runLottery, runStride and finalizeMetrics on synthetic workloads (see
+//   generateWorkload) across a range of n, every arrival distribution (Poisson, bursty, all-at-zero),
+//   both burst distributions (exponential, heavy-tailed Pareto) and several
+//   RR quanta.
+// - CompactRR/* runs RR into a CompactTimeline and also reports its
+//   bytes/segment.
+// - Context/* and ContextMetrics/* repeat runs on one SimulationContext (with
+//   and without a timeline) and fail if a run after the first allocates.
+// - Online/* feeds the same workloads to OnlineScheduler one submit() at a
+//   time, draining every 4096 submissions, and also reports events/s
+//   (submissions plus emitted segments).
+// - Reports ns/process, segments/s and heap allocations per run, so a
+//   complexity regression shows up as ns/process growing with n.
+// - Build:  g++ -std=gnu++17 -O2 -pthread -o scheduler_bench scheduler_bench.cpp -lbenchmark
+// - Run:    ./scheduler_bench [--benchmark_filter=SJF/poisson]
+// -------------------------------------------------------------
+
+// Only the engines are used here; the CLI pieces would warn as unused.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#define SCHEDULER_NO_MAIN
+#include "cpu_scheduling_simulator_c (1).cpp"
+#pragma GCC diagnostic pop
+
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <map>
+#include <new>
+#include <tuple>
+
+// ---------- Allocation counting ----------
+// Every global operator new goes through here; the array and nothrow forms
+// forward to it in libstdc++. (GCC flags the malloc/free pairing below as
+// mismatched once the operators are inlined; it is what they are meant to do.)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+static atomic<unsigned long long> g_allocs{0};
+
+void* operator new(size_t size) {
+    g_allocs.fetch_add(1, memory_order_relaxed);
+    if (void *p = malloc(size ? size : 1)) return p;
+    throw bad_alloc();
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+// ---------- Workloads ----------
+
+static const size_t kSizes[] = {1 << 10, 1 << 13, 1 << 16, 1 << 19};
+static const ArrivalDist kArrivals[] = {ArrivalDist::Poisson, ArrivalDist::Bursty, ArrivalDist::AllAtZero};
+static const BurstDist kBursts[] = {BurstDist::Exponential, BurstDist::HeavyTailed};
+static const int kQuanta[] = {1, 4, 16};
+
+// Generated on first use per (n, arrivals, bursts) and shared by every
+// benchmark over that workload
+struct WorkloadKey { size_t n; ArrivalDist a; BurstDist b; };
+
+static const ProcessColumns& workload(const WorkloadKey& k) {
+    static map<tuple<size_t, int, int>, ProcessColumns> cache;
+    auto key = make_tuple(k.n, (int)k.a, (int)k.b);
+    auto it = cache.find(key);
+    if (it == cache.end()) {
+        WorkloadSpec w;
+        w.n = k.n; w.arrivals = k.a; w.bursts = k.b;
+        mt19937_64 rng(k.n * 31 + (int)k.a * 7 + (int)k.b);
+        vector<Process> ps;
+        generateWorkload(w, rng, ps);
+        it = cache.emplace(key, makeColumns(ps)).first;
+    }
+    return it->second;
+}
+
+// seconds: wall time spent inside the timed calls across all iterations
+static void report(benchmark::State& st, size_t n, size_t segments, double seconds,
+                   unsigned long long allocs) {
+    using benchmark::Counter;
+    double runs = (double)max<benchmark::IterationCount>(st.iterations(), 1);
+    st.counters["ns/process"] = n ? seconds * 1e9 / (runs * n) : 0.0;
+    st.counters["segments/s"] = seconds > 0 ? segments * runs / seconds : 0.0;
+    st.counters["allocs/run"] = Counter((double)allocs, Counter::kAvgIterations);
+}
+
+static double since(chrono::steady_clock::time_point t0) {
+    return chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+}
+
+// run(view) returns a Result whose timeline is recycled between iterations,
+// as repeated menu runs do. Runs with a compact timeline also report its
+// bytes per segment.
+template <class Run>
+static void benchRun(benchmark::State& st, WorkloadKey k, Run run) {
+    ProcessView v = workload(k).view();
+    size_t segments = 0, packedBytes = 0;
+    unsigned long long before = g_allocs.load(memory_order_relaxed);
+    double seconds = 0.0;
+    for (auto _ : st) {
+        auto t0 = chrono::steady_clock::now();
+        Result r = run(v);
+        seconds += since(t0);
+        segments = r.packed.empty() ? r.timeline.size() : r.packed.size();
+        packedBytes = r.packed.bytes();
+        benchmark::DoNotOptimize(r.avg_wait);
+        recycleTimeline(move(r));
+    }
+    report(st, v.n, segments, seconds, g_allocs.load(memory_order_relaxed) - before);
+    if (packedBytes) st.counters["bytes/segment"] = (double)packedBytes / max<size_t>(segments, 1);
+}
+
+// finalizeMetrics alone, over an RR q=4 timeline that is moved back out of
+// the Result after each call.
+static void benchFinalize(benchmark::State& st, WorkloadKey k) {
+    ProcessView v = workload(k).view();
+    vector<Segment> tl = runRR(v, 4).timeline;
+    unsigned long long before = g_allocs.load(memory_order_relaxed);
+    double seconds = 0.0;
+    for (auto _ : st) {
+        auto t0 = chrono::steady_clock::now();
+        Result r = finalizeMetrics("RR", v, move(tl));
+        seconds += since(t0);
+        benchmark::DoNotOptimize(r.avg_wait);
+        tl = move(r.timeline);
+    }
+    report(st, v.n, tl.size(), seconds, g_allocs.load(memory_order_relaxed) - before);
+}
+
+// run(ctx, view) on one SimulationContext, warmed up by a first run outside
+// the timed loop. Every later run must be allocation-free: the benchmark
+// fails if any iteration reaches operator new.
+template <class Run>
+static void benchContext(benchmark::State& st, WorkloadKey k, bool timeline, Run run) {
+    ProcessView v = workload(k).view();
+    SimulationContext ctx(timeline);
+    size_t segments = run(ctx, v).timeline.size();
+    unsigned long long before = g_allocs.load(memory_order_relaxed);
+    double seconds = 0.0;
+    for (auto _ : st) {
+        auto t0 = chrono::steady_clock::now();
+        const Result &r = run(ctx, v);
+        seconds += since(t0);
+        benchmark::DoNotOptimize(r.avg_wait);
+    }
+    unsigned long long allocs = g_allocs.load(memory_order_relaxed) - before;
+    report(st, v.n, segments, seconds, allocs);
+    if (allocs) st.SkipWithError("SimulationContext allocated after warmup");
+}
+
+// Streams the workload in arrival order through a fresh scheduler per run.
+static void benchOnline(benchmark::State& st, WorkloadKey k, OnlinePolicy p) {
+    ProcessView v = workload(k).view();
+    vector<Segment> segs;
+    size_t segments = 0;
+    unsigned long long before = g_allocs.load(memory_order_relaxed);
+    double seconds = 0.0;
+    for (auto _ : st) {
+        auto t0 = chrono::steady_clock::now();
+        OnlineScheduler sched(p, 4);
+        segments = 0;
+        for (size_t i = 0; i < v.n; ++i) {
+            uint32_t r = v.byArrival[i];
+            sched.submit({v.pid[r], v.arrival[r], v.burst[r], v.priority[r]});
+            if ((i & 4095) == 4095) { sched.drainSegments(segs); segments += segs.size(); segs.clear(); }
+        }
+        sched.close();
+        sched.drainSegments(segs); segments += segs.size(); segs.clear();
+        seconds += since(t0);
+        benchmark::DoNotOptimize(sched.avgWait());
+    }
+    report(st, v.n, segments, seconds, g_allocs.load(memory_order_relaxed) - before);
+    double runs = (double)max<benchmark::IterationCount>(st.iterations(), 1);
+    st.counters["events/s"] = seconds > 0 ? (v.n + segments) * runs / seconds : 0.0;
+}
+
+static void registerAll() {
+    for (ArrivalDist a : kArrivals)
+    for (BurstDist b : kBursts)
+    for (size_t n : kSizes) {
+        WorkloadKey k{n, a, b};
+        string tag = string("/") + arrivalDistName(a) + "/" + burstDistName(b) + "/n:" + to_string(n);
+
+        benchmark::RegisterBenchmark(("FCFS" + tag).c_str(), [k](benchmark::State& st){
+            benchRun(st, k, [](const ProcessView& v){ return runFCFS(v); });
+        });
+        benchmark::RegisterBenchmark(("SJF" + tag).c_str(), [k](benchmark::State& st){
+            benchRun(st, k, [](const ProcessView& v){ return runSJF(v); });
+        });
+        benchmark::RegisterBenchmark(("PriorityNP" + tag).c_str(), [k](benchmark::State& st){
+            benchRun(st, k, [](const ProcessView& v){ return runPriorityNP(v); });
+        });
+        benchmark::RegisterBenchmark(("SRTF" + tag).c_str(), [k](benchmark::State& st){
+            benchRun(st, k, [](const ProcessView& v){ return runSRTF(v); });
+        });
+        benchmark::RegisterBenchmark(("PriorityP" + tag).c_str(), [k](benchmark::State& st){
+            benchRun(st, k, [](const ProcessView& v){ return runPriorityP(v); });
+        });
+        for (int q : kQuanta) {
+            benchmark::RegisterBenchmark(("RR" + tag + "/q:" + to_string(q)).c_str(), [k, q](benchmark::State& st){
+                benchRun(st, k, [q](const ProcessView& v){ return runRR(v, q); });
+            });
+            benchmark::RegisterBenchmark(("CompactRR" + tag + "/q:" + to_string(q)).c_str(), [k, q](benchmark::State& st){
+                benchRun(st, k, [q](const ProcessView& v){ return runRR<CompactTimelineSink>(v, q); });
+            });
+        }
+        benchmark::RegisterBenchmark(("MLFQ" + tag).c_str(), [k](benchmark::State& st){
+            benchRun(st, k, [](const ProcessView& v){ return runMLFQ(v, defaultMlfq(4)); });
+        });
+        benchmark::RegisterBenchmark(("Lottery" + tag + "/q:4").c_str(), [k](benchmark::State& st){
+            benchRun(st, k, [](const ProcessView& v){ return runLottery(v, 4); });
+        });
+        benchmark::RegisterBenchmark(("Stride" + tag + "/q:4").c_str(), [k](benchmark::State& st){
+            benchRun(st, k, [](const ProcessView& v){ return runStride(v, 4); });
+        });
+        for (bool timeline : {true, false}) {
+            string ctx = timeline ? "Context/" : "ContextMetrics/";
+            benchmark::RegisterBenchmark((ctx + "FCFS" + tag).c_str(), [k, timeline](benchmark::State& st){
+                benchContext(st, k, timeline, [](SimulationContext& c, const ProcessView& v) -> const Result& { return c.runFCFS(v); });
+            });
+            benchmark::RegisterBenchmark((ctx + "SJF" + tag).c_str(), [k, timeline](benchmark::State& st){
+                benchContext(st, k, timeline, [](SimulationContext& c, const ProcessView& v) -> const Result& { return c.runSJF(v); });
+            });
+            benchmark::RegisterBenchmark((ctx + "PriorityNP" + tag).c_str(), [k, timeline](benchmark::State& st){
+                benchContext(st, k, timeline, [](SimulationContext& c, const ProcessView& v) -> const Result& { return c.runPriorityNP(v); });
+            });
+            benchmark::RegisterBenchmark((ctx + "SRTF" + tag).c_str(), [k, timeline](benchmark::State& st){
+                benchContext(st, k, timeline, [](SimulationContext& c, const ProcessView& v) -> const Result& { return c.runSRTF(v); });
+            });
+            benchmark::RegisterBenchmark((ctx + "RR" + tag + "/q:4").c_str(), [k, timeline](benchmark::State& st){
+                benchContext(st, k, timeline, [](SimulationContext& c, const ProcessView& v) -> const Result& { return c.runRR(v, 4); });
+            });
+            benchmark::RegisterBenchmark((ctx + "MLFQ" + tag).c_str(), [k, timeline](benchmark::State& st){
+                MlfqOptions o = defaultMlfq(4);
+                benchContext(st, k, timeline, [o](SimulationContext& c, const ProcessView& v) -> const Result& { return c.runMLFQ(v, o); });
+            });
+            benchmark::RegisterBenchmark((ctx + "Lottery" + tag + "/q:4").c_str(), [k, timeline](benchmark::State& st){
+                benchContext(st, k, timeline, [](SimulationContext& c, const ProcessView& v) -> const Result& { return c.runLottery(v, 4); });
+            });
+            benchmark::RegisterBenchmark((ctx + "Stride" + tag + "/q:4").c_str(), [k, timeline](benchmark::State& st){
+                benchContext(st, k, timeline, [](SimulationContext& c, const ProcessView& v) -> const Result& { return c.runStride(v, 4); });
+            });
+        }
+        static const pair<const char*, OnlinePolicy> online[] = {
+            {"FCFS", OnlinePolicy::FCFS}, {"SJF", OnlinePolicy::SJF}, {"RR", OnlinePolicy::RoundRobin},
+            {"SRTF", OnlinePolicy::SRTF},
+        };
+        for (const auto &o : online) {
+            OnlinePolicy p = o.second;
+            benchmark::RegisterBenchmark((string("Online/") + o.first + tag).c_str(), [k, p](benchmark::State& st){
+                benchOnline(st, k, p);
+            });
+        }
+        benchmark::RegisterBenchmark(("finalizeMetrics" + tag).c_str(), [k](benchmark::State& st){
+            benchFinalize(st, k);
+        });
+    }
+}
+
+int main(int argc, char **argv) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    registerAll();
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}